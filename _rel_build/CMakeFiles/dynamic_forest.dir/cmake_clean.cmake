@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dynamic_forest.dir/main.cpp.o"
+  "CMakeFiles/dynamic_forest.dir/main.cpp.o.d"
+  "dynamic_forest"
+  "dynamic_forest.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dynamic_forest.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dynamic_forest_bench.dir/bench_main.cpp.o"
+  "CMakeFiles/dynamic_forest_bench.dir/bench_main.cpp.o.d"
+  "dynamic_forest_bench"
+  "dynamic_forest_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dynamic_forest_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/dynamic_forest_load.dir/load_main.cpp.o"
+  "CMakeFiles/dynamic_forest_load.dir/load_main.cpp.o.d"
+  "dynamic_forest_load"
+  "dynamic_forest_load.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/dynamic_forest_load.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
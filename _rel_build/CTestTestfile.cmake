@@ -0,0 +1,14 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_rel_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test([=[dynamic_forest]=] "/root/repo/_rel_build/dynamic_forest")
+set_tests_properties([=[dynamic_forest]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;22;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[dynamic_forest_fuzz]=] "/root/repo/_rel_build/dynamic_forest_fuzz" "100000" "200000" "1337" "2")
+set_tests_properties([=[dynamic_forest_fuzz]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;23;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[dynamic_forest_load]=] "/root/repo/_rel_build/dynamic_forest_load" "100000" "4" "64" "50000" "1")
+set_tests_properties([=[dynamic_forest_load]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;24;add_test;/root/repo/CMakeLists.txt;0;")
+add_test([=[dynamic_forest_bench]=] "/root/repo/_rel_build/dynamic_forest_bench" "100000" "100000" "10000" "4")
+set_tests_properties([=[dynamic_forest_bench]=] PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;25;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "concurrent_forest.h"
+#include "euler_tour_tree.h"
+
+
+//  the walks as they were before RootAndPos: LeftSize of every ancestor on the way up,
+//  and a separate walk for the root
+namespace generic {
+    template<typename DataType>
+    TreapVertex<DataType>* GetTreapRoot(TreapVertex<DataType>* vertex) {
+        while (vertex->ancestor) {
+            vertex = vertex->ancestor;
+        }
+        return vertex;
+    }
+
+    template<typename DataType>
+    uint32_t PosNumberInTreap(TreapVertex<DataType>* vertex) {
+        uint32_t pos = vertex->LeftSize();
+        while (vertex->ancestor) {
+            if (vertex->ancestor->right_son == vertex) {
+                pos += vertex->ancestor->LeftSize() + 1;
+            }
+            vertex = vertex->ancestor;
+        }
+        return pos;
+    }
+
+    //  treap vertices the walk reads: the path, the left son of the start
+    //  and the left son of every ancestor above a right son
+    template<typename DataType>
+    uint32_t PosNumberReads(TreapVertex<DataType>* vertex) {
+        uint32_t reads = 1 + (vertex->left_son != nullptr);
+        for (; vertex->ancestor; vertex = vertex->ancestor) {
+            ++reads;
+            reads += vertex->ancestor->right_son == vertex && vertex->ancestor->left_son;
+        }
+        return reads;
+    }
+}
+
+//  RootAndPos reads the path and the left son of the start
+template<typename DataType>
+uint32_t RootAndPosReads(TreapVertex<DataType>* vertex) {
+    uint32_t reads = 1 + (vertex->left_son != nullptr);
+    for (; vertex->ancestor; vertex = vertex->ancestor) {
+        ++reads;
+    }
+    return reads;
+}
+
+template<typename Function>
+double NanosecondsPerCall(size_t calls, Function&& function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / static_cast<double>(calls);
+}
+
+//  the two versions run in alternating rounds and each keeps its best round,
+//  so neither profits from the caches the other one warmed
+template<typename Generic, typename Fused>
+std::pair<double, double> Compare(size_t calls, Generic&& generic, Fused&& fused) {
+    constexpr int kRounds = 9;
+    double generic_best = 1e18;
+    double fused_best = 1e18;
+    for (int round = 0; round < kRounds; ++round) {
+        generic_best = std::min(generic_best, NanosecondsPerCall(calls, generic));
+        fused_best = std::min(fused_best, NanosecondsPerCall(calls, fused));
+    }
+    return {generic_best, fused_best};
+}
+
+//  cuts and links of ConcurrentDynamicForest with every thread on a tree of its own,
+//  so the stripes never collide and the throughput should grow with the threads
+double DisjointUpdatesPerSecond(int threads, int vertices_per_thread, size_t updates_per_thread) {
+    ConcurrentDynamicForest forest{threads * vertices_per_thread};
+    std::vector<std::vector<std::pair<int, int>>> edges(threads);
+    for (int thread = 0; thread < threads; ++thread) {
+        std::mt19937 rng(thread);
+        int begin = thread * vertices_per_thread;
+        for (int v_num = 1; v_num < vertices_per_thread; ++v_num) {
+            edges[thread].emplace_back(begin + rng() % v_num, begin + v_num);
+            forest.AddEdge(edges[thread].back().first, edges[thread].back().second);
+        }
+    }
+
+    std::atomic<bool> start{false};
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; ++thread) {
+        workers.emplace_back([&, thread] {
+            std::mt19937 rng(thread);
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            for (size_t it = 0; it < updates_per_thread; ++it) {
+                auto [u_num, v_num] = edges[thread][rng() % edges[thread].size()];
+                forest.RemoveEdge(u_num, v_num);
+                forest.AddEdge(u_num, v_num);
+            }
+        });
+    }
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+    return 2.0 * static_cast<double>(updates_per_thread) * threads / elapsed.count();
+}
+
+//  usage: dynamic_forest_bench [arcs] [calls] [forest_vertices] [max_threads]
+//  times the position and root kernels on one deep treap of tour arcs, cold and hot: one
+//  position walk, and the walks of a cut as separate walks against RootAndPositions, which
+//  interleaves them. Then the cut and link of DynamicForest that use them, then
+//  ConcurrentDynamicForest on disjoint components with 1, 2, 4, ... threads
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+
+    size_t arcs_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 22;
+    size_t calls = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200'000;
+    int vertex_count = argc > 3 ? std::atoi(argv[3]) : 1 << 20;
+    int max_threads = argc > 4 ? std::atoi(argv[4])
+                               : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::mt19937 rng{1337};
+    std::vector<TreapVertex<TourArc>> arcs(arcs_count);
+    std::vector<TreapVertex<TourArc>*> order(arcs_count);
+    for (size_t idx = 0; idx < arcs_count; ++idx) {
+        arcs[idx].treap_priority = rng();
+        order[idx] = &arcs[idx];
+    }
+    //  a random layout in memory, as arcs allocated over a long run end up
+    std::shuffle(order.begin(), order.end(), rng);
+    treap::BuildTreap(order.data(), order.size());
+
+    size_t max_depth = 0;
+    double total_depth = 0;
+    for (auto& arc : arcs) {
+        size_t depth = 0;
+        for (auto vertex = &arc; vertex->ancestor; vertex = vertex->ancestor) {
+            ++depth;
+        }
+        max_depth = std::max(max_depth, depth);
+        total_depth += static_cast<double>(depth);
+    }
+    std::cout << "treap of " << arcs_count << " arcs, depth " << total_depth / arcs_count
+              << " on average, " << max_depth << " at most\n";
+
+    for (size_t pool_size : {size_t{64}, arcs_count}) {
+        //  pairs of arcs as RemoveEdge gets them: both positions and the root of the first
+        std::vector<std::pair<TreapVertex<TourArc>*, TreapVertex<TourArc>*>> queries(calls);
+        for (auto& [one, two] : queries) {
+            one = &arcs[rng() % pool_size];
+            two = &arcs[rng() % pool_size];
+        }
+        uint64_t generic_sum = 0;
+        uint64_t fused_sum = 0;
+        uint64_t generic_reads = 0;
+        uint64_t fused_reads = 0;
+        for (auto [one, two] : queries) {
+            generic_reads += generic::PosNumberReads(one) + generic::PosNumberReads(two) +
+                RootAndPosReads(one) - (one->left_son != nullptr);
+            fused_reads += RootAndPosReads(one) + RootAndPosReads(two);
+        }
+        auto [generic_pos, fused_pos] = Compare(calls, [&] {
+            for (auto [one, two] : queries) {
+                generic_sum += generic::PosNumberInTreap(one);
+            }
+        }, [&] {
+            for (auto [one, two] : queries) {
+                fused_sum += treap::PosNumberInTreap(one);
+            }
+        });
+        auto [generic_cut, fused_cut] = Compare(calls, [&] {
+            for (auto [one, two] : queries) {
+                auto pos_one = generic::PosNumberInTreap(one);
+                auto pos_two = generic::PosNumberInTreap(two);
+                auto root = generic::GetTreapRoot(one);
+                generic_sum += pos_one + pos_two + reinterpret_cast<uintptr_t>(root);
+            }
+        }, [&] {
+            for (auto [one, two] : queries) {
+                auto [root, pos_one, pos_two] = treap::RootAndPositions(one, two);
+                fused_sum += pos_one + pos_two + reinterpret_cast<uintptr_t>(root);
+            }
+        });
+        if (generic_sum != fused_sum) {
+            std::cerr << "kernels disagree\n";
+            return 1;
+        }
+        std::cout << (pool_size == arcs_count ? "cold" : "hot ") << " position: "
+                  << generic_pos << " ns -> " << fused_pos << " ns, walks of a cut: "
+                  << generic_cut << " ns -> " << fused_cut << " ns, vertices read by a cut: "
+                  << static_cast<double>(generic_reads) / static_cast<double>(calls) << " -> "
+                  << static_cast<double>(fused_reads) / static_cast<double>(calls) << "\n";
+    }
+
+    std::vector<std::pair<int, int>> edges;
+    for (int v_num = 1; v_num < vertex_count; ++v_num) {
+        edges.emplace_back(rng() % v_num, v_num);
+    }
+    auto forest = DynamicForest::Build(vertex_count, edges);
+    size_t updates = std::min(calls, edges.size());
+    auto cut_link = NanosecondsPerCall(updates, [&] {
+        for (size_t it = 0; it < updates; ++it) {
+            auto [u_num, v_num] = edges[rng() % edges.size()];
+            forest.RemoveEdge(u_num, v_num);
+            forest.AddEdge(u_num, v_num);
+        }
+    });
+    std::cout << "cut and link on a tree of " << vertex_count << " vertices: " << cut_link << " ns\n";
+
+    //  the trees of all threads together stay under kMaxConcurrentVertices, so a many-core
+    //  host does not multiply the memory of the run by its core count
+    constexpr int kMaxConcurrentVertices = 1 << 20;
+    std::cout << "concurrent updates on disjoint trees, " << std::thread::hardware_concurrency()
+              << " cores:\n";
+    double single = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        int tree_size = std::max(2, std::min(vertex_count, kMaxConcurrentVertices / threads));
+        auto per_second = DisjointUpdatesPerSecond(threads, tree_size, updates);
+        single = threads == 1 ? per_second : single;
+        std::cout << "  " << threads << " threads on trees of " << tree_size << " vertices: "
+                  << per_second << " updates/s, x" << per_second / single << "\n";
+    }
+    return 0;
+}
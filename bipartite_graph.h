@@ -0,0 +1,63 @@
+#ifndef DYNAMIC_FOREST_BIPARTITE_GRAPH_H
+#define DYNAMIC_FOREST_BIPARTITE_GRAPH_H
+
+#include "dynamic_graph.h"
+
+//  bipartiteness through the double cover: v has copies v and v + n, an edge (u, v) becomes
+//  (u, v + n) and (u + n, v). A walk between copies of the same vertex has odd length exactly
+//  when it ends at the other copy, so a component is bipartite iff the two copies of its vertices
+//  stay apart, and two vertices are on the same side iff their first copies meet.
+//  Every answer is a connectivity question on the cover, and every update changes two edges, so
+//  both cost what they cost in DynamicGraph: O(log^4 n) amortized per update, with replacement
+//  edges found by level promotion however many edges cross a cut.
+class BipartiteGraph {
+public:
+    explicit BipartiteGraph(int vertex_count) : size_{vertex_count}, cover_{2 * vertex_count} {
+    }
+
+    bool HasEdge(int u_num, int v_num) const {
+        return cover_.HasEdge(u_num, v_num + size_);
+    }
+
+    //  a loop is allowed and makes its component odd; false if the edge is already there
+    bool AddEdge(int u_num, int v_num) {
+        if (!cover_.AddEdge(u_num, v_num + size_)) {
+            return false;
+        }
+        if (u_num != v_num) {
+            cover_.AddEdge(u_num + size_, v_num);
+        }
+        return true;
+    }
+
+    //  false if there is no such edge
+    bool RemoveEdge(int u_num, int v_num) {
+        if (!cover_.RemoveEdge(u_num, v_num + size_)) {
+            return false;
+        }
+        if (u_num != v_num) {
+            cover_.RemoveEdge(u_num + size_, v_num);
+        }
+        return true;
+    }
+
+    bool IsConnected(int u_num, int v_num) {
+        return cover_.IsConnected(u_num, v_num) || cover_.IsConnected(u_num, v_num + size_);
+    }
+
+    //  whether the component of v has no odd cycle
+    bool IsBipartite(int v_num) {
+        return !cover_.IsConnected(v_num, v_num + size_);
+    }
+
+    //  u and v lie in one bipartite component and every path between them is even
+    bool SameSide(int u_num, int v_num) {
+        return cover_.IsConnected(u_num, v_num) && IsBipartite(u_num);
+    }
+
+private:
+    int size_{};
+    DynamicGraph cover_;
+};
+
+#endif //DYNAMIC_FOREST_BIPARTITE_GRAPH_H
@@ -0,0 +1,126 @@
+#ifndef DYNAMIC_FOREST_COMPACT_FOREST_H
+#define DYNAMIC_FOREST_COMPACT_FOREST_H
+
+#include <cassert>
+#include <cinttypes>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "index_treap.h"
+
+//  DynamicForest for at most MaxVertices vertices: arcs live in one array and link each
+//  other by index, index 0 is a null node of size 0, and every width is chosen at compile time;
+//  below 2^15 vertices an arc is 12 bytes. The arrays are sized for the bound and allocated once
+//  by the constructor, so the object itself is small and may live on the stack.
+//  Only the core of DynamicForest is offered: AddEdge, RemoveEdge, IsConnected and the
+//  component count, no growth, persistence, transactions, events or selection
+template<uint32_t MaxVertices>
+class CompactForest {
+    static_assert(MaxVertices > 0);
+
+    static constexpr uint64_t kMaxArcs = 2 * (static_cast<uint64_t>(MaxVertices) - 1);
+
+public:
+    using Index = std::conditional_t<(kMaxArcs < UINT16_MAX), uint16_t, uint32_t>;
+    using Key = std::conditional_t<
+        (static_cast<uint64_t>(MaxVertices) * MaxVertices <= UINT32_MAX), uint32_t, uint64_t>;
+
+    using Node = index_treap::Node<Index>;
+
+    static_assert(sizeof(Index) > 2 || sizeof(Node) <= 12);
+
+    explicit CompactForest(int vertex_count, const uint32_t seed = 1337)
+        : size_{vertex_count}, rng_state_{seed | 1} {
+        assert(0 <= vertex_count && static_cast<uint32_t>(vertex_count) <= MaxVertices);
+        for (Index idx = 0; idx < kMaxArcs; ++idx) {
+            free_arcs_[idx] = static_cast<Index>(kMaxArcs - idx);
+        }
+        free_count_ = kMaxArcs;
+    }
+
+    int GetComponentsNumber() const {
+        return size_ - static_cast<int>((kMaxArcs - free_count_) / 2);
+    }
+
+    void AddEdge(int u_num, int v_num) {
+        Index edge_forward = CreateArc();
+        Index edge_backward = CreateArc();
+        Table().Insert(EncodeEdge(u_num, v_num), edge_forward);
+        Table().Insert(EncodeEdge(v_num, u_num), edge_backward);
+        Treap().Link(representative_[u_num], representative_[v_num], edge_forward, edge_backward);
+
+        if (!representative_[u_num]) {
+            representative_[u_num] = edge_forward;
+        }
+        if (!representative_[v_num]) {
+            representative_[v_num] = edge_backward;
+        }
+    }
+
+    void RemoveEdge(int u_num, int v_num) {
+        Index edge_one = Table().Erase(EncodeEdge(u_num, v_num));
+        Index edge_two = Table().Erase(EncodeEdge(v_num, u_num));
+        auto treap = Treap();
+        representative_[u_num] = treap.RepresentativeAfterCut(representative_[u_num], edge_one, edge_two);
+        representative_[v_num] = treap.RepresentativeAfterCut(representative_[v_num], edge_two, edge_one);
+        treap.Cut(edge_one, edge_two);
+        free_arcs_[free_count_++] = edge_one;
+        free_arcs_[free_count_++] = edge_two;
+    }
+
+    bool IsConnected(int u_num, int v_num) const {
+        if (u_num == v_num) {
+            return true;
+        }
+        auto u_vertex = representative_[u_num];
+        auto v_vertex = representative_[v_num];
+        if (!u_vertex || !v_vertex) {
+            return false;
+        }
+        return index_treap::GetTreapRoot(nodes_.data(), u_vertex) ==
+            index_treap::GetTreapRoot(nodes_.data(), v_vertex);
+    }
+
+private:
+    using TableEntry = index_treap::TableEntry<Key, Index>;
+
+    static constexpr size_t kTableSize = [] {
+        size_t capacity = 2;
+        while (capacity < 2 * kMaxArcs) {
+            capacity *= 2;
+        }
+        return capacity;
+    }();
+
+    static Key EncodeEdge(int u_num, int v_num) {
+        return static_cast<Key>(u_num) * MaxVertices + static_cast<Key>(v_num);
+    }
+
+    index_treap::Treap<Index> Treap() {
+        return index_treap::Treap<Index>{nodes_.data()};
+    }
+
+    index_treap::EdgeTable<Key, Index> Table() {
+        return {table_.data(), kTableSize};
+    }
+
+    Index CreateArc() {
+        Index arc = free_arcs_[--free_count_];
+        rng_state_ ^= rng_state_ << 13;
+        rng_state_ ^= rng_state_ >> 17;
+        rng_state_ ^= rng_state_ << 5;
+        Treap().Create(arc, rng_state_);
+        return arc;
+    }
+
+    int size_{};
+    uint32_t rng_state_{};
+    uint64_t free_count_{};
+    std::vector<Node> nodes_ = std::vector<Node>(kMaxArcs + 1);
+    std::vector<Index> free_arcs_ = std::vector<Index>(kMaxArcs);
+    std::vector<Index> representative_ = std::vector<Index>(MaxVertices);
+    std::vector<TableEntry> table_ = std::vector<TableEntry>(kTableSize);
+};
+
+#endif //DYNAMIC_FOREST_COMPACT_FOREST_H
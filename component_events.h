@@ -0,0 +1,223 @@
+#ifndef DYNAMIC_FOREST_COMPONENT_EVENTS_H
+#define DYNAMIC_FOREST_COMPONENT_EVENTS_H
+
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "spsc_ring.h"
+
+struct ComponentEvent {
+    enum class Kind : uint8_t {
+        Merged,  //  `other` was merged into `survivor`
+        Split,   //  `other` was cut off `survivor`
+    };
+
+    Kind kind;
+    uint32_t survivor_size;  //  after the change
+    uint32_t other_size;     //  before a merge, after a split
+    uint64_t survivor;
+    uint64_t other;
+};
+
+using ComponentEventRing = SpscRing<ComponentEvent>;
+
+//  the component ids of a subscribed DynamicForest and the merge and split events it pushes.
+//  A tree is known by the root of its tour treap, an isolated vertex by its number; a merge keeps
+//  the id of the larger side, a split keeps it for the larger piece and gives the others new ones.
+//  Inside a transaction events are held back until Commit and dropped by Rollback, which also
+//  restores the ids.
+template<typename Vertex>
+class ComponentEvents {
+public:
+    //  root is null for an isolated vertex
+    struct Component {
+        Vertex* root;
+        int vertex;
+        uint32_t size;
+    };
+
+    bool Subscribed() const {
+        return ring_ != nullptr;
+    }
+
+    //  locate(v) is v's component as it is now
+    template<typename Locate>
+    void Subscribe(ComponentEventRing* ring, int vertex_count, Locate&& locate) {
+        assert(!held_ && ring);
+        ring_ = ring;
+        tree_ids_.clear();
+        isolated_ids_.assign(vertex_count, 0);
+        for (int v_num = 0; v_num < vertex_count; ++v_num) {
+            auto component = locate(v_num);
+            if (!component.root) {
+                isolated_ids_[v_num] = next_id_++;
+            } else if (!tree_ids_.contains(component.root)) {
+                tree_ids_[component.root] = next_id_++;
+            }
+        }
+    }
+
+    void Unsubscribe() {
+        assert(!held_);
+        ring_ = nullptr;
+        tree_ids_.clear();
+        isolated_ids_.clear();
+    }
+
+    //  an appended vertex is a single-vertex component under an id not seen before
+    void AddVertex() {
+        if (ring_) {
+            isolated_ids_.push_back(next_id_++);
+        }
+    }
+
+    //  undoes AddVertex
+    void DropLastVertex() {
+        if (ring_) {
+            isolated_ids_.pop_back();
+        }
+    }
+
+    uint64_t IdOf(const Component& component) const {
+        return component.root ? tree_ids_.at(component.root) : isolated_ids_[component.vertex];
+    }
+
+    //  u_whole and v_whole were located before the edge was added, merged after
+    void Merge(const Component& u_whole, const Component& v_whole, const Component& merged) {
+        auto survivor = u_whole;
+        auto other = v_whole;
+        if (survivor.size < other.size) {
+            std::swap(survivor, other);
+        }
+        auto survivor_id = IdOf(survivor);
+        auto other_id = IdOf(other);
+        ForgetId(u_whole.root);
+        ForgetId(v_whole.root);
+        SetId(merged, survivor_id);
+        Emit({ComponentEvent::Kind::Merged, merged.size, other.size, survivor_id, other_id});
+    }
+
+    //  whole was located before the cut; every piece contains one of the given vertices
+    template<typename Locate>
+    void Split(const Component& whole, std::span<const int> vertices, Locate&& locate) {
+        auto id = IdOf(whole);
+        ForgetId(whole.root);
+
+        std::vector<std::pair<uintptr_t, Component>> pieces;
+        pieces.reserve(vertices.size());
+        for (auto v_num : vertices) {
+            auto piece = locate(v_num);
+            auto key = piece.root ? reinterpret_cast<uintptr_t>(piece.root)
+                                  : 2 * static_cast<uintptr_t>(v_num) + 1;
+            pieces.emplace_back(key, piece);
+        }
+        std::sort(pieces.begin(), pieces.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+        pieces.erase(std::unique(pieces.begin(), pieces.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first == rhs.first;
+        }), pieces.end());
+
+        auto largest = std::max_element(pieces.begin(), pieces.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.size < rhs.second.size;
+        });
+        SetId(largest->second, id);
+        //  the pieces are cut off one at a time, so every event leaves the sizes consistent
+        auto remaining = whole.size;
+        for (auto iter = pieces.begin(); iter != pieces.end(); ++iter) {
+            if (iter != largest) {
+                auto other_id = next_id_++;
+                SetId(iter->second, other_id);
+                remaining -= iter->second.size;
+                Emit({ComponentEvent::Kind::Split, remaining, iter->second.size, id, other_id});
+            }
+        }
+    }
+
+    void Begin() {
+        held_ = true;
+        start_id_ = next_id_;
+    }
+
+    void Commit() {
+        held_ = false;
+        id_log_.clear();
+        for (const auto& event : pending_events_) {
+            ring_->Push(event);
+        }
+        pending_events_.clear();
+    }
+
+    void Rollback() {
+        held_ = false;
+        for (auto iter = id_log_.rbegin(); iter != id_log_.rend(); ++iter) {
+            if (!iter->root) {
+                isolated_ids_[iter->vertex] = iter->id;
+            } else if (iter->existed) {
+                tree_ids_[iter->root] = iter->id;
+            } else {
+                tree_ids_.erase(iter->root);
+            }
+        }
+        id_log_.clear();
+        pending_events_.clear();
+        next_id_ = start_id_;
+    }
+
+private:
+    struct IdChange {
+        Vertex* root;
+        int vertex;
+        bool existed;
+        uint64_t id;
+    };
+
+    void SetId(const Component& component, uint64_t id) {
+        if (held_) {
+            auto iter = component.root ? tree_ids_.find(component.root) : tree_ids_.end();
+            id_log_.push_back({component.root, component.vertex, iter != tree_ids_.end(),
+                               component.root ? (iter != tree_ids_.end() ? iter->second : 0)
+                                              : isolated_ids_[component.vertex]});
+        }
+        if (component.root) {
+            tree_ids_[component.root] = id;
+        } else {
+            isolated_ids_[component.vertex] = id;
+        }
+    }
+
+    void ForgetId(Vertex* root) {
+        if (!root) {
+            return;
+        }
+        auto iter = tree_ids_.find(root);
+        if (held_) {
+            id_log_.push_back({root, 0, true, iter->second});
+        }
+        tree_ids_.erase(iter);
+    }
+
+    void Emit(const ComponentEvent& event) {
+        if (held_) {
+            pending_events_.push_back(event);
+        } else {
+            ring_->Push(event);
+        }
+    }
+
+    ComponentEventRing* ring_{};
+    bool held_{false};
+    uint64_t next_id_{};
+    uint64_t start_id_{};
+    std::unordered_map<Vertex*, uint64_t> tree_ids_{};
+    std::vector<uint64_t> isolated_ids_{};
+    std::vector<IdChange> id_log_{};
+    std::vector<ComponentEvent> pending_events_{};
+};
+
+#endif //DYNAMIC_FOREST_COMPONENT_EVENTS_H
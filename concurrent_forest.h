@@ -0,0 +1,297 @@
+#ifndef DYNAMIC_FOREST_CONCURRENT_FOREST_H
+#define DYNAMIC_FOREST_CONCURRENT_FOREST_H
+
+#include <atomic>
+#include <cinttypes>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "euler_tour_tree.h"
+#include "treap.h"
+
+struct ConcurrentArc {
+    //  FindRoot walks the ancestor links without a lock
+    static constexpr bool kAtomicAncestor = true;
+
+    Edge edge;
+    //  set while the arc is the root of a tree nobody is changing; guarded by the root's stripe
+    std::atomic<bool> published{false};
+};
+
+
+//  DynamicForest for many updating threads. A component is locked through the stripe of its
+//  treap root, an isolated vertex through a stripe of its own. A thread finds the root by an
+//  unlocked walk, locks the stripes in address order and keeps the result only if the root is
+//  still published and still above the vertex; otherwise it unlocks and retries.
+//  An update unpublishes the roots it holds and publishes the new roots after unlocking, so a
+//  tree in the middle of a change has no published root and nobody can validate against it.
+//  Arcs are recycled and never freed, so a walk that races with a writer only reads stale
+//  links of live arcs, and its answer is thrown away by the validation.
+class ConcurrentDynamicForest {
+public:
+    explicit ConcurrentDynamicForest(int vertex_count, const uint32_t seed = 1337)
+        : size_{vertex_count}, representative_(vertex_count), stripes_(kStripes), shards_(kShards) {
+        for (size_t idx = 0; idx < kShards; ++idx) {
+            shards_[idx].rng.seed(seed + idx);
+        }
+    }
+
+    int GetComponentsNumber() const {
+        return size_ - edges_number_.load(std::memory_order_relaxed);
+    }
+
+    //  false if u and v are already connected
+    bool AddEdge(int u_num, int v_num) {
+        if (u_num == v_num) {
+            return false;
+        }
+        auto [u_locked, v_locked] = LockComponents(u_num, v_num);
+        if (u_locked.key == v_locked.key) {
+            Unlock(u_locked.key, v_locked.key);
+            return false;
+        }
+        Unpublish(u_locked);
+        Unpublish(v_locked);
+
+        auto key = EncodeEdge(u_num, v_num);
+        auto& shard = ShardOf(key);
+        Arc* edge_forward;
+        Arc* edge_backward;
+        {
+            std::lock_guard guard{shard.mutex};
+            edge_forward = CreateArc(shard, {u_num, v_num});
+            edge_backward = CreateArc(shard, {v_num, u_num});
+            shard.arcs[key] = u_num < v_num ? std::pair{edge_forward, edge_backward}
+                                            : std::pair{edge_backward, edge_forward};
+        }
+        edges_number_.fetch_add(1, std::memory_order_relaxed);
+
+        auto u_vertex = representative_[u_num].load(std::memory_order_relaxed);
+        auto v_vertex = representative_[v_num].load(std::memory_order_relaxed);
+        auto root = treap::LinkTours(u_vertex, v_vertex, edge_forward, edge_backward);
+
+        if (!u_vertex) {
+            representative_[u_num].store(edge_forward, std::memory_order_release);
+        }
+        if (!v_vertex) {
+            representative_[v_num].store(edge_backward, std::memory_order_release);
+        }
+        Unlock(u_locked.key, v_locked.key);
+        Publish(root);
+        return true;
+    }
+
+    //  false if there is no edge (u, v)
+    bool RemoveEdge(int u_num, int v_num) {
+        if (u_num == v_num) {
+            return false;
+        }
+        auto [u_locked, v_locked] = LockComponents(u_num, v_num);
+        if (u_locked.key != v_locked.key) {
+            Unlock(u_locked.key, v_locked.key);
+            return false;
+        }
+
+        auto key = EncodeEdge(u_num, v_num);
+        auto& shard = ShardOf(key);
+        Arc* edge_one;
+        Arc* edge_two;
+        {
+            std::lock_guard guard{shard.mutex};
+            auto iter = shard.arcs.find(key);
+            if (iter == shard.arcs.end()) {
+                Unlock(u_locked.key, v_locked.key);
+                return false;
+            }
+            std::tie(edge_one, edge_two) = iter->second;
+            shard.arcs.erase(iter);
+        }
+        if (u_num > v_num) {
+            std::swap(edge_one, edge_two);
+        }
+        Unpublish(u_locked);
+
+        auto root = u_locked.root;
+        auto u_next = treap::RepresentativeAfterCut(
+            representative_[u_num].load(std::memory_order_relaxed), edge_one, edge_two, root);
+        auto v_next = treap::RepresentativeAfterCut(
+            representative_[v_num].load(std::memory_order_relaxed), edge_two, edge_one, root);
+        auto [outer, inner] = treap::CutTour(edge_one, edge_two);
+        representative_[u_num].store(u_next, std::memory_order_release);
+        representative_[v_num].store(v_next, std::memory_order_release);
+        {
+            std::lock_guard guard{shard.mutex};
+            shard.free_arcs.push_back(edge_one);
+            shard.free_arcs.push_back(edge_two);
+        }
+        edges_number_.fetch_sub(1, std::memory_order_relaxed);
+
+        Unlock(u_locked.key, v_locked.key);
+        Publish(outer);
+        Publish(inner);
+        return true;
+    }
+
+    bool IsConnected(int u_num, int v_num) {
+        if (u_num == v_num) {
+            return true;
+        }
+        auto [u_locked, v_locked] = LockComponents(u_num, v_num);
+        Unlock(u_locked.key, v_locked.key);
+        return u_locked.key == v_locked.key;
+    }
+
+private:
+    using Arc = TreapVertex<ConcurrentArc>;
+    //  a published root's address, or an odd number 2v + 1 for an isolated vertex v
+    using Key = uintptr_t;
+
+    struct Locked {
+        Key key;
+        Arc* root;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::pair<Arc*, Arc*>> arcs;
+        std::deque<Arc> storage;
+        std::vector<Arc*> free_arcs;
+        std::mt19937 rng;
+    };
+
+    static constexpr size_t kStripes = 1024;
+    static constexpr size_t kShards = 64;
+    //  a walk longer than this is looking at a tree in the middle of a change
+    static constexpr size_t kMaxWalk = 1 << 16;
+
+    static uint64_t EncodeEdge(int u_num, int v_num) {
+        if (u_num > v_num) {
+            std::swap(u_num, v_num);
+        }
+        return (static_cast<uint64_t>(static_cast<uint32_t>(u_num)) << 32) |
+            static_cast<uint32_t>(v_num);
+    }
+
+    static uint64_t Mix(uint64_t value) {
+        return value * 0x9E3779B97F4A7C15ull;
+    }
+
+    Shard& ShardOf(uint64_t key) {
+        return shards_[Mix(key) >> 58];
+    }
+
+    std::mutex& StripeOf(Key key) {
+        return stripes_[Mix(key) >> 54].mutex;
+    }
+
+    Arc* CreateArc(Shard& shard, Edge edge) {
+        Arc* arc;
+        if (shard.free_arcs.empty()) {
+            arc = &shard.storage.emplace_back();
+        } else {
+            arc = shard.free_arcs.back();
+            shard.free_arcs.pop_back();
+        }
+        arc->data.edge = edge;
+        arc->size_of_treap = 1;
+        arc->treap_priority = shard.rng();
+        arc->left_son = arc->right_son = nullptr;
+        //  a recycled arc can still be on the walk of a stale FindRoot
+        arc->SetAncestor(nullptr);
+        return arc;
+    }
+
+    static Arc* FindRoot(Arc* vertex) {
+        for (size_t step = 0; step < kMaxWalk; ++step) {
+            auto ancestor = vertex->LoadAncestor();
+            if (!ancestor) {
+                return vertex;
+            }
+            vertex = ancestor;
+        }
+        return nullptr;
+    }
+
+    std::pair<Locked, Locked> LockComponents(int u_num, int v_num) {
+        while (true) {
+            auto u_locked = Candidate(u_num);
+            auto v_locked = Candidate(v_num);
+            if (u_locked.key && v_locked.key) {
+                auto* first = &StripeOf(u_locked.key);
+                auto* second = &StripeOf(v_locked.key);
+                if (first > second) {
+                    std::swap(first, second);
+                }
+                first->lock();
+                if (second != first) {
+                    second->lock();
+                }
+                if (Validate(u_num, u_locked) && Validate(v_num, v_locked)) {
+                    return {u_locked, v_locked};
+                }
+                Unlock(u_locked.key, v_locked.key);
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    Locked Candidate(int v_num) {
+        auto vertex = representative_[v_num].load(std::memory_order_acquire);
+        if (!vertex) {
+            return {2 * static_cast<Key>(v_num) + 1, nullptr};
+        }
+        auto root = FindRoot(vertex);
+        return {reinterpret_cast<Key>(root), root};
+    }
+
+    //  called with the stripe of locked.key held: a published root cannot change under it,
+    //  and an isolated vertex only stops being isolated under its own stripe
+    bool Validate(int v_num, const Locked& locked) {
+        auto vertex = representative_[v_num].load(std::memory_order_acquire);
+        if (!locked.root) {
+            return !vertex;
+        }
+        return vertex && locked.root->data.published.load(std::memory_order_relaxed) &&
+            FindRoot(vertex) == locked.root;
+    }
+
+    void Unlock(Key u_key, Key v_key) {
+        auto* first = &StripeOf(u_key);
+        auto* second = &StripeOf(v_key);
+        if (second != first) {
+            second->unlock();
+        }
+        first->unlock();
+    }
+
+    static void Unpublish(const Locked& locked) {
+        if (locked.root) {
+            locked.root->data.published.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void Publish(Arc* root) {
+        if (!root) {
+            return;
+        }
+        std::lock_guard guard{StripeOf(reinterpret_cast<Key>(root))};
+        root->data.published.store(true, std::memory_order_relaxed);
+    }
+
+    int size_{};
+    std::atomic<int> edges_number_{0};
+    std::vector<std::atomic<Arc*>> representative_;
+    std::vector<Stripe> stripes_;
+    std::vector<Shard> shards_;
+};
+
+#endif //DYNAMIC_FOREST_CONCURRENT_FOREST_H
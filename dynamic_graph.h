@@ -0,0 +1,636 @@
+#ifndef DYNAMIC_FOREST_DYNAMIC_GRAPH_H
+#define DYNAMIC_FOREST_DYNAMIC_GRAPH_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cinttypes>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//  general graph over a spanning forest with the 2-edge connectivity scheme of Holm, de
+//  Lichtenberg and Thorup. Every non-tree edge has a level and covers its tree path at that
+//  level; the cover level of a tree edge is the highest level covering it, and -1 marks a bridge.
+//  The vertices joined by tree edges of cover at least i (an i-component) never exceed n / 2^i,
+//  so there are at most log n levels.
+//  Deleting a non-tree edge of level i uncovers its path, then each level from i down recovers
+//  it from both ends: non-tree edges of the level hanging off the path rise a level while their
+//  new component stays small enough, and the first one that can not rise covers its path at the
+//  level and ends that side. A deleted tree edge of cover level i first trades places with a
+//  crossing non-tree edge of level i, met by raising the non-crossing ones on the smaller side,
+//  and is then deleted as a non-tree edge of level i. An edge rises at most log n times.
+//
+//  The forest is a link-cut tree with nodes for the edges, as in WeightedForest. A splay tree
+//  keeps per level how many vertices hang off its path through edges of cover at least the level,
+//  and how many non-tree edge ends of the level they hold. Cover and uncover are lazy on the
+//  path; an uncover changes the level at which path edges stop a walk, so the reach from either
+//  end of the path is kept for every pair of level and stopping level. A forest operation is
+//  O(log^3 n) amortized and an update O(log^4 n) amortized. Parallel edges and loops are not
+//  supported.
+class DynamicGraph {
+public:
+    explicit DynamicGraph(int vertex_count)
+        : size_{vertex_count},
+          levels_{std::max(1, static_cast<int>(std::bit_width(static_cast<unsigned>(vertex_count))) - 1)},
+          non_tree_neighbours_(vertex_count, std::vector<std::vector<int>>(levels_)) {
+        for (int level = 0; level < levels_; ++level) {
+            row_.push_back(cells_);
+            cells_ += levels_ - level + 1;
+        }
+        nodes_.reserve(2 * vertex_count);
+        for (int v_num = 0; v_num < vertex_count; ++v_num) {
+            nodes_.push_back(MakeNode());
+            Pull(v_num);
+        }
+    }
+
+    int GetComponentsNumber() const {
+        return size_ - static_cast<int>(tree_edges_.size());
+    }
+
+    bool HasEdge(int u_num, int v_num) const {
+        return tree_edges_.contains(EncodeEdge(u_num, v_num)) ||
+            non_tree_edges_.contains(EncodeEdge(u_num, v_num));
+    }
+
+    //  false for a loop or an edge that is already there
+    bool AddEdge(int u_num, int v_num) {
+        if (u_num == v_num || HasEdge(u_num, v_num)) {
+            return false;
+        }
+        if (IsConnected(u_num, v_num)) {
+            AttachNonTree(u_num, v_num, 0);
+            CoverPath(u_num, v_num, Tag{-1, 0});
+        } else {
+            Link(u_num, v_num);
+        }
+        return true;
+    }
+
+    //  false if there is no such edge
+    bool RemoveEdge(int u_num, int v_num) {
+        int level;
+        if (non_tree_edges_.contains(EncodeEdge(u_num, v_num))) {
+            level = DetachNonTree(u_num, v_num);
+        } else {
+            auto iter = tree_edges_.find(EncodeEdge(u_num, v_num));
+            if (iter == tree_edges_.end()) {
+                return false;
+            }
+            Access(iter->second);
+            level = nodes_[iter->second].cover;
+            Cut(u_num, v_num);
+            if (level < 0) {
+                return true;
+            }
+            auto [a_num, b_num] = FindReplacement(u_num, v_num, level);
+            DetachNonTree(a_num, b_num);
+            Link(a_num, b_num);
+        }
+        //  the edge covered the path between its ends at its level
+        CoverPath(u_num, v_num, Tag{level, -1});
+        for (; level >= 0; --level) {
+            Recover(u_num, v_num, level);
+        }
+        return true;
+    }
+
+    bool IsConnected(int u_num, int v_num) {
+        return u_num == v_num || FindRoot(u_num) == FindRoot(v_num);
+    }
+
+    //  only a tree edge that no non-tree edge covers
+    bool IsBridge(int u_num, int v_num) {
+        auto iter = tree_edges_.find(EncodeEdge(u_num, v_num));
+        if (iter == tree_edges_.end()) {
+            return false;
+        }
+        Access(iter->second);
+        return nodes_[iter->second].cover < 0;
+    }
+
+    //  u and v survive any single edge failure together iff no tree edge on their path is a bridge
+    bool Is2EdgeConnected(int u_num, int v_num) {
+        if (u_num == v_num) {
+            return true;
+        }
+        if (!IsConnected(u_num, v_num)) {
+            return false;
+        }
+        Expose(u_num, v_num);
+        return nodes_[v_num].min_cover >= 0;
+    }
+
+private:
+    //  vertices reachable from a path and the non-tree edge ends of one level they hold
+    struct Reach {
+        int vertices;
+        int ends;
+
+        Reach operator+(Reach other) const {
+            return {vertices + other.vertices, ends + other.ends};
+        }
+
+        Reach operator-(Reach other) const {
+            return {vertices - other.vertices, ends - other.ends};
+        }
+    };
+
+    //  a cover level c becomes max(cover, c <= uncover ? -1 : c); {-1, -1} leaves it alone
+    struct Tag {
+        int uncover{-1};
+        int cover{-1};
+
+        bool IsIdentity() const {
+            return uncover < 0 && cover < 0;
+        }
+
+        int Apply(int level) const {
+            return std::max(cover, level <= uncover ? -1 : level);
+        }
+
+        //  this tag followed by the other one
+        Tag Then(Tag other) const {
+            if (cover <= other.uncover) {
+                return {std::max(uncover, other.uncover), other.cover};
+            }
+            return {uncover, std::max(cover, other.cover)};
+        }
+    };
+
+    //  the cover level of a vertex node: a walk always passes it
+    static constexpr int kVertex = std::numeric_limits<int>::max();
+
+    struct Node {
+        int left{-1};
+        int right{-1};
+        int parent{-1};  //  splay parent, or path parent at a splay root
+        bool flip{false};
+        int cover{kVertex};
+        Tag tag{};
+
+        int min_cover{kVertex};  //  over the edge nodes of the splay subtree
+        int first{-1};  //  the ends of the splay subtree's path
+        int last{-1};
+        std::vector<Reach> hanging{};  //  per level, summed over the virtual children
+        std::vector<Reach> total{};  //  per level, off the whole path
+        //  per level and stopping level, walking in from the first (or last) node and stopping
+        //  at the first edge whose cover is below the stopping level
+        std::vector<Reach> prefix{};
+        std::vector<Reach> suffix{};
+        std::set<std::pair<int, int>> reaching{};  //  {level, first node} of virtual children
+                                                   //  with ends of the level in reach
+    };
+
+    struct NonTreeEdge {
+        int level;
+        std::array<int, 2> slot;  //  where each end, the smaller first, lists the other one
+    };
+
+    static uint64_t EncodeEdge(int u_num, int v_num) {
+        if (u_num > v_num) {
+            std::swap(u_num, v_num);
+        }
+        return (static_cast<uint64_t>(static_cast<uint32_t>(u_num)) << 32) |
+            static_cast<uint32_t>(v_num);
+    }
+
+    Node MakeNode() const {
+        Node node;
+        node.hanging.resize(levels_);
+        node.total.resize(levels_);
+        node.prefix.resize(cells_);
+        node.suffix.resize(cells_);
+        return node;
+    }
+
+    int CreateEdgeNode() {
+        int edge;
+        if (free_nodes_.empty()) {
+            edge = static_cast<int>(nodes_.size());
+            nodes_.push_back(MakeNode());
+        } else {
+            edge = free_nodes_.back();
+            free_nodes_.pop_back();
+            nodes_[edge] = MakeNode();
+        }
+        nodes_[edge].cover = -1;
+        Pull(edge);
+        return edge;
+    }
+
+    Reach Own(int node, int level) const {
+        auto reach = nodes_[node].hanging[level];
+        if (node < size_) {
+            reach.vertices += 1;
+            reach.ends += static_cast<int>(non_tree_neighbours_[node][level].size());
+        }
+        return reach;
+    }
+
+    void Pull(int node) {
+        auto& current = nodes_[node];
+        const Node* left = current.left >= 0 ? &nodes_[current.left] : nullptr;
+        const Node* right = current.right >= 0 ? &nodes_[current.right] : nullptr;
+        current.min_cover = std::min({left ? left->min_cover : kVertex, current.cover,
+                                      right ? right->min_cover : kVertex});
+        current.first = left ? left->first : node;
+        current.last = right ? right->last : node;
+        for (int level = 0, cell = 0; level < levels_; ++level) {
+            auto own = Own(node, level);
+            auto left_total = left ? left->total[level] : Reach{};
+            auto right_total = right ? right->total[level] : Reach{};
+            current.total[level] = left_total + own + right_total;
+            for (int stop = level; stop <= levels_; ++stop, ++cell) {
+                bool pass = current.cover >= stop;
+                if (left && left->min_cover < stop) {
+                    current.prefix[cell] = left->prefix[cell];
+                } else {
+                    current.prefix[cell] = left_total +
+                        (pass ? own + (right ? right->prefix[cell] : Reach{}) : Reach{});
+                }
+                if (right && right->min_cover < stop) {
+                    current.suffix[cell] = right->suffix[cell];
+                } else {
+                    current.suffix[cell] = right_total +
+                        (pass ? own + (left ? left->suffix[cell] : Reach{}) : Reach{});
+                }
+            }
+        }
+    }
+
+    //  after the tag an edge of cover c passes the stopping level s iff s <= cover, or c passes
+    //  max(s, uncover + 1); stopping levels go up, so the cells read are not rewritten yet
+    void ApplyTag(int node, Tag tag) {
+        auto& current = nodes_[node];
+        current.cover = tag.Apply(current.cover);
+        current.min_cover = tag.Apply(current.min_cover);
+        for (int level = 0, cell = 0; level < levels_; ++level) {
+            for (int stop = level; stop <= levels_; ++stop, ++cell) {
+                if (stop <= tag.cover) {
+                    current.prefix[cell] = current.total[level];
+                    current.suffix[cell] = current.total[level];
+                } else if (stop <= tag.uncover) {
+                    int moved = row_[level] + tag.uncover + 1 - level;
+                    current.prefix[cell] = current.prefix[moved];
+                    current.suffix[cell] = current.suffix[moved];
+                }
+            }
+        }
+        current.tag = current.tag.Then(tag);
+    }
+
+    void ApplyFlip(int node) {
+        auto& current = nodes_[node];
+        std::swap(current.left, current.right);
+        std::swap(current.prefix, current.suffix);
+        std::swap(current.first, current.last);
+        current.flip = !current.flip;
+    }
+
+    void Push(int node) {
+        auto& current = nodes_[node];
+        if (current.flip) {
+            if (current.left >= 0) {
+                ApplyFlip(current.left);
+            }
+            if (current.right >= 0) {
+                ApplyFlip(current.right);
+            }
+            current.flip = false;
+        }
+        if (!current.tag.IsIdentity()) {
+            if (current.left >= 0) {
+                ApplyTag(current.left, current.tag);
+            }
+            if (current.right >= 0) {
+                ApplyTag(current.right, current.tag);
+            }
+            current.tag = {};
+        }
+    }
+
+    //  a virtual child is the subtree below its first node, whatever the shape of its splay
+    //  tree, so the values added for it are still there to take away
+    void AddVirtual(int node, int child) {
+        auto& current = nodes_[node];
+        const auto& cluster = nodes_[child];
+        for (int level = 0; level < levels_; ++level) {
+            auto reach = cluster.prefix[row_[level]];
+            current.hanging[level] = current.hanging[level] + reach;
+            if (reach.ends) {
+                current.reaching.emplace(level, cluster.first);
+            }
+        }
+    }
+
+    void RemoveVirtual(int node, int child) {
+        auto& current = nodes_[node];
+        const auto& cluster = nodes_[child];
+        for (int level = 0; level < levels_; ++level) {
+            auto reach = cluster.prefix[row_[level]];
+            current.hanging[level] = current.hanging[level] - reach;
+            if (reach.ends) {
+                current.reaching.erase({level, cluster.first});
+            }
+        }
+    }
+
+    bool IsSplayRoot(int node) const {
+        int parent = nodes_[node].parent;
+        return parent < 0 || (nodes_[parent].left != node && nodes_[parent].right != node);
+    }
+
+    void Rotate(int node) {
+        int parent = nodes_[node].parent;
+        int grand = nodes_[parent].parent;
+        bool parent_is_root = IsSplayRoot(parent);
+        if (nodes_[parent].left == node) {
+            nodes_[parent].left = nodes_[node].right;
+            if (nodes_[node].right >= 0) {
+                nodes_[nodes_[node].right].parent = parent;
+            }
+            nodes_[node].right = parent;
+        } else {
+            nodes_[parent].right = nodes_[node].left;
+            if (nodes_[node].left >= 0) {
+                nodes_[nodes_[node].left].parent = parent;
+            }
+            nodes_[node].left = parent;
+        }
+        nodes_[parent].parent = node;
+        nodes_[node].parent = grand;
+        if (!parent_is_root) {
+            if (nodes_[grand].left == parent) {
+                nodes_[grand].left = node;
+            } else {
+                nodes_[grand].right = node;
+            }
+        }
+        Pull(parent);
+    }
+
+    void Splay(int node) {
+        splay_path_.clear();
+        for (int current = node;; current = nodes_[current].parent) {
+            splay_path_.push_back(current);
+            if (IsSplayRoot(current)) {
+                break;
+            }
+        }
+        for (auto iter = splay_path_.rbegin(); iter != splay_path_.rend(); ++iter) {
+            Push(*iter);
+        }
+        while (!IsSplayRoot(node)) {
+            int parent = nodes_[node].parent;
+            if (!IsSplayRoot(parent)) {
+                int grand = nodes_[parent].parent;
+                bool zig_zig = (nodes_[grand].left == parent) == (nodes_[parent].left == node);
+                Rotate(zig_zig ? parent : node);
+            }
+            Rotate(node);
+        }
+        Pull(node);
+    }
+
+    //  makes the path from the root to the node preferred; the node ends as the splay root
+    //  whose cluster is the whole tree
+    void Access(int node) {
+        for (int current = node, last = -1; current >= 0; last = current, current = nodes_[current].parent) {
+            Splay(current);
+            if (nodes_[current].right >= 0) {
+                AddVirtual(current, nodes_[current].right);
+            }
+            if (last >= 0) {
+                RemoveVirtual(current, last);
+            }
+            nodes_[current].right = last;
+            Pull(current);
+        }
+        Splay(node);
+    }
+
+    void MakeRoot(int node) {
+        Access(node);
+        ApplyFlip(node);
+    }
+
+    //  the splay tree of v is then the path u..v and nothing else
+    void Expose(int u_num, int v_num) {
+        MakeRoot(u_num);
+        Access(v_num);
+    }
+
+    int FindRoot(int node) {
+        Access(node);
+        while (true) {
+            Push(node);
+            if (nodes_[node].left < 0) {
+                break;
+            }
+            node = nodes_[node].left;
+        }
+        Splay(node);
+        return node;
+    }
+
+    void Link(int u_num, int v_num) {
+        int edge = CreateEdgeNode();
+        tree_edges_[EncodeEdge(u_num, v_num)] = edge;
+
+        MakeRoot(u_num);
+        nodes_[u_num].parent = edge;
+        AddVirtual(edge, u_num);
+        Pull(edge);
+
+        Access(v_num);
+        nodes_[edge].parent = v_num;
+        AddVirtual(v_num, edge);
+        Pull(v_num);
+    }
+
+    void Cut(int u_num, int v_num) {
+        auto iter = tree_edges_.find(EncodeEdge(u_num, v_num));
+        int edge = iter->second;
+        tree_edges_.erase(iter);
+        CutAbove(u_num, edge);
+        CutAbove(v_num, edge);
+        free_nodes_.push_back(edge);
+    }
+
+    //  detaches a vertex from the edge node next to it
+    void CutAbove(int v_num, int edge) {
+        MakeRoot(v_num);
+        Access(edge);
+        assert(nodes_[edge].left == v_num && nodes_[v_num].right < 0);
+        nodes_[edge].left = -1;
+        nodes_[v_num].parent = -1;
+        Pull(edge);
+    }
+
+    void CoverPath(int u_num, int v_num, Tag tag) {
+        Expose(u_num, v_num);
+        ApplyTag(v_num, tag);
+    }
+
+    void AttachNonTree(int u_num, int v_num, int level) {
+        NonTreeEdge record{level, {}};
+        std::array ends{std::min(u_num, v_num), std::max(u_num, v_num)};
+        for (int side = 0; side < 2; ++side) {
+            int x_num = ends[side];
+            auto& neighbours = non_tree_neighbours_[x_num][level];
+            Access(x_num);
+            record.slot[side] = static_cast<int>(neighbours.size());
+            neighbours.push_back(ends[1 - side]);
+            Pull(x_num);
+        }
+        non_tree_edges_[EncodeEdge(u_num, v_num)] = record;
+    }
+
+    //  the level the edge had
+    int DetachNonTree(int u_num, int v_num) {
+        auto iter = non_tree_edges_.find(EncodeEdge(u_num, v_num));
+        auto record = iter->second;
+        non_tree_edges_.erase(iter);
+        std::array ends{std::min(u_num, v_num), std::max(u_num, v_num)};
+        for (int side = 0; side < 2; ++side) {
+            int x_num = ends[side];
+            auto& neighbours = non_tree_neighbours_[x_num][record.level];
+            Access(x_num);
+            int moved = neighbours.back();
+            neighbours[record.slot[side]] = moved;
+            neighbours.pop_back();
+            if (record.slot[side] < static_cast<int>(neighbours.size())) {
+                non_tree_edges_.at(EncodeEdge(x_num, moved)).slot[x_num < moved ? 0 : 1] = record.slot[side];
+            }
+            Pull(x_num);
+        }
+        return record.level;
+    }
+
+    void Raise(int u_num, int v_num, int level) {
+        assert(level + 1 < levels_);
+        DetachNonTree(u_num, v_num);
+        AttachNonTree(u_num, v_num, level + 1);
+        CoverPath(u_num, v_num, Tag{-1, level + 1});
+    }
+
+    //  the first node of a splay tree's path, walking in from the front through edges of cover
+    //  at least the level, that holds ends of the level itself or in its virtual children
+    int FirstReaching(int node, int level) {
+        while (true) {
+            Push(node);
+            const auto& current = nodes_[node];
+            if (current.left >= 0 && nodes_[current.left].prefix[row_[level]].ends) {
+                node = current.left;
+                continue;
+            }
+            assert(current.cover >= level);
+            if (Own(node, level).ends) {
+                return node;
+            }
+            node = current.right;
+        }
+    }
+
+    //  a vertex with non-tree edges of the level reachable from the node off its path; the
+    //  access at the end pays for the descent through the virtual children
+    int FindHanging(int node, int level) {
+        while (node >= size_ || non_tree_neighbours_[node][level].empty()) {
+            auto iter = nodes_[node].reaching.lower_bound({level, -1});
+            assert(iter != nodes_[node].reaching.end() && iter->first == level);
+            int top = iter->second;
+            Splay(top);
+            node = FirstReaching(top, level);
+        }
+        Access(node);
+        return node;
+    }
+
+    //  a vertex with non-tree edges of the level hanging off the exposed path u..v through
+    //  edges of cover at least the level, hung nearest to u (or v); -1 if there is none
+    int FindOffPath(int v_num, int level, bool near_u) {
+        if (!nodes_[v_num].total[level].ends) {
+            return -1;
+        }
+        int node = v_num;
+        while (true) {
+            Push(node);
+            const auto& current = nodes_[node];
+            int near = near_u ? current.left : current.right;
+            if (near >= 0 && nodes_[near].total[level].ends) {
+                node = near;
+            } else if (Own(node, level).ends) {
+                return FindHanging(node, level);
+            } else {
+                node = near_u ? current.right : current.left;
+            }
+        }
+    }
+
+    //  the level-component of the path u..v if the path were covered at the level
+    int PathComponentSize(int u_num, int v_num, int level) {
+        Expose(u_num, v_num);
+        return nodes_[v_num].total[level].vertices;
+    }
+
+    //  a non-tree edge of the level across the cut tree edge (u, v) of that cover level. The
+    //  non-crossing ones on the smaller side rise a level: their new components stay inside
+    //  that side, at most n / 2^(level + 1) vertices
+    std::pair<int, int> FindReplacement(int u_num, int v_num, int level) {
+        MakeRoot(u_num);
+        auto u_reach = nodes_[u_num].prefix[row_[level]].vertices;
+        MakeRoot(v_num);
+        auto v_reach = nodes_[v_num].prefix[row_[level]].vertices;
+        int small = u_reach <= v_reach ? u_num : v_num;
+        while (true) {
+            MakeRoot(small);
+            int x_num = FindHanging(FirstReaching(small, level), level);
+            int y_num = non_tree_neighbours_[x_num][level].back();
+            if (!IsConnected(small, y_num)) {
+                return {x_num, y_num};
+            }
+            Raise(x_num, y_num, level);
+        }
+    }
+
+    //  covers the path u..v again with the non-tree edges of the level after an uncover. From
+    //  each end the edge hung nearest rises if its component stays small, or covers its path and
+    //  ends the side. Two edges that can not rise each bring more than n / 2^(level + 1)
+    //  vertices of the level-component of the path, so their covers meet and leave no gap
+    void Recover(int u_num, int v_num, int level) {
+        for (bool near_u : {true, false}) {
+            while (true) {
+                Expose(u_num, v_num);
+                int x_num = FindOffPath(v_num, level, near_u);
+                if (x_num < 0) {
+                    return;
+                }
+                int y_num = non_tree_neighbours_[x_num][level].back();
+                if (level + 1 < levels_ && PathComponentSize(x_num, y_num, level + 1) <= size_ >> (level + 1)) {
+                    Raise(x_num, y_num, level);
+                } else {
+                    CoverPath(x_num, y_num, Tag{-1, level});
+                    break;
+                }
+            }
+        }
+    }
+
+    int size_{};
+    int levels_{};
+    int cells_{};
+    std::vector<int> row_{};  //  the first prefix cell of each level
+    std::vector<Node> nodes_{};
+    std::vector<int> free_nodes_{};
+    std::unordered_map<uint64_t, int> tree_edges_{};
+    std::unordered_map<uint64_t, NonTreeEdge> non_tree_edges_{};
+    std::vector<std::vector<std::vector<int>>> non_tree_neighbours_{};  //  per vertex and level
+    std::vector<int> splay_path_{};
+};
+
+#endif //DYNAMIC_FOREST_DYNAMIC_GRAPH_H
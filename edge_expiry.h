@@ -0,0 +1,153 @@
+#ifndef DYNAMIC_FOREST_EDGE_EXPIRY_H
+#define DYNAMIC_FOREST_EDGE_EXPIRY_H
+
+#include <cassert>
+#include <cinttypes>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+//  the timers of the timed edges of a DynamicForest. A timed edge gets a timer holding its expiry
+//  and both its arcs, and a deadline pointing at the timer, so Advance reaches the arcs without
+//  looking the edge up. Removing the edge by hand earlier stops the timer and its deadline is
+//  skipped when its turn comes; the timer is freed only then.
+template<typename Vertex>
+class EdgeExpiry {
+public:
+    static constexpr uint64_t kNoExpiry = UINT64_MAX;
+    static constexpr uint32_t kNoTimer = UINT32_MAX;
+
+    uint64_t Now() const {
+        return now_;
+    }
+
+    //  the timer of a new edge
+    uint32_t Start(uint64_t expiry, Vertex* forward, Vertex* backward) {
+        assert(expiry != kNoExpiry);
+        uint32_t timer;
+        if (free_timers_.empty()) {
+            timer = static_cast<uint32_t>(timers_.size());
+            timers_.emplace_back();
+        } else {
+            timer = free_timers_.back();
+            free_timers_.pop_back();
+        }
+        timers_[timer] = {expiry, forward, backward};
+        ++timed_edges_;
+        //  a fixed time-to-live gives deadlines in order, they queue up without a heap
+        if (ordered_deadlines_.empty() || ordered_deadlines_.back().expiry <= expiry) {
+            ordered_deadlines_.push_back({expiry, timer});
+        } else {
+            deadlines_.push({expiry, timer});
+        }
+        return timer;
+    }
+
+    //  the edge of the timer is gone; returns the expiry it had, kNoExpiry for kNoTimer
+    uint64_t Stop(uint32_t timer) {
+        uint64_t expiry = kNoExpiry;
+        if (timer != kNoTimer) {
+            std::swap(expiry, timers_[timer].expiry);
+            --timed_edges_;
+        }
+        return expiry;
+    }
+
+    //  undoes Stop
+    void Restore(uint32_t timer, uint64_t expiry) {
+        if (timer != kNoTimer) {
+            timers_[timer].expiry = expiry;
+            ++timed_edges_;
+        }
+    }
+
+    //  collects the edges whose expiry is at most the new time into Expired and ExpiredArcs;
+    //  the forest stops their timers when it cuts them
+    size_t Advance(uint64_t time) {
+        assert(now_ <= time);
+        now_ = time;
+        expired_.clear();
+        expired_arcs_.clear();
+        auto expire = [&](const Deadline& deadline) {
+            //  a timer has one deadline, so nothing else can pop it before the cut stops it
+            const auto& timer = timers_[deadline.timer];
+            if (timer.expiry != kNoExpiry) {
+                expired_.emplace_back(timer.forward->data.from, timer.forward->data.to);
+                expired_arcs_.emplace_back(timer.forward, timer.backward);
+            }
+            free_timers_.push_back(deadline.timer);
+        };
+        while (!ordered_deadlines_.empty() && ordered_deadlines_.front().expiry <= time) {
+            expire(ordered_deadlines_.front());
+            ordered_deadlines_.pop_front();
+        }
+        while (!deadlines_.empty() && deadlines_.top().expiry <= time) {
+            expire(deadlines_.top());
+            deadlines_.pop();
+        }
+        //  deadlines of edges removed by hand pile up; drop them once they are the majority
+        if (ordered_deadlines_.size() + deadlines_.size() > 2 * timed_edges_ + kDeadlineSlack) {
+            std::erase_if(ordered_deadlines_, [this](const Deadline& deadline) {
+                return !IsLive(deadline);
+            });
+            std::vector<Deadline> live;
+            for (; !deadlines_.empty(); deadlines_.pop()) {
+                if (IsLive(deadlines_.top())) {
+                    live.push_back(deadlines_.top());
+                }
+            }
+            deadlines_ = decltype(deadlines_){std::greater<>{}, std::move(live)};
+        }
+        return expired_.size();
+    }
+
+    const std::vector<std::pair<int, int>>& Expired() const {
+        return expired_;
+    }
+
+    const std::vector<std::pair<Vertex*, Vertex*>>& ExpiredArcs() const {
+        return expired_arcs_;
+    }
+
+private:
+    static constexpr size_t kDeadlineSlack = 1024;
+
+    //  expiry is kNoExpiry once the edge expired or was removed by hand
+    struct Timer {
+        uint64_t expiry;
+        Vertex* forward;
+        Vertex* backward;
+    };
+
+    struct Deadline {
+        uint64_t expiry;
+        uint32_t timer;
+
+        bool operator>(const Deadline& other) const {
+            return expiry > other.expiry;
+        }
+    };
+
+    //  whether the edge the deadline was set for is still there; a dropped deadline frees its timer
+    bool IsLive(const Deadline& deadline) {
+        if (timers_[deadline.timer].expiry != kNoExpiry) {
+            return true;
+        }
+        free_timers_.push_back(deadline.timer);
+        return false;
+    }
+
+    uint64_t now_{};
+    size_t timed_edges_{};
+    std::vector<Timer> timers_{};
+    std::vector<uint32_t> free_timers_{};
+    std::deque<Deadline> ordered_deadlines_{};
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines_{};
+    std::vector<std::pair<int, int>> expired_{};
+    std::vector<std::pair<Vertex*, Vertex*>> expired_arcs_{};
+};
+
+#endif //DYNAMIC_FOREST_EDGE_EXPIRY_H
@@ -0,0 +1,326 @@
+#ifndef DYNAMIC_FOREST_EDGE_LIST_LOADER_H
+#define DYNAMIC_FOREST_EDGE_LIST_LOADER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "euler_tour_tree.h"
+
+enum class EdgeListFormat {
+    Binary,  //  pairs of little-endian uint32
+    Text,    //  "u v" per line, lines starting with '#' or '%' are comments
+};
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            madvise(data, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(data);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    const char* Data() const {
+        return data_;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    const char* data_{};
+    size_t size_{};
+};
+
+
+namespace edge_list {
+    inline unsigned DefaultThreads() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    template<typename Function>
+    void ParallelFor(unsigned threads, Function&& function) {
+        std::vector<std::thread> workers;
+        for (unsigned idx = 1; idx < threads; ++idx) {
+            workers.emplace_back(function, idx);
+        }
+        function(0u);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    //  chunk borders are moved to the next line start, so no line is cut in two
+    inline std::vector<size_t> TextChunks(const char* data, size_t size, unsigned threads) {
+        std::vector<size_t> borders(threads + 1, size);
+        borders[0] = 0;
+        for (unsigned idx = 1; idx < threads; ++idx) {
+            size_t pos = std::max(borders[idx - 1], size / threads * idx);
+            while (pos < size && pos > 0 && data[pos - 1] != '\n') {
+                ++pos;
+            }
+            borders[idx] = pos;
+        }
+        return borders;
+    }
+
+    //  thrown by ParseText with the start of the bad line; the caller turns it into a line number
+    struct MalformedLine {
+        const char* line;
+    };
+
+    //  walks the lines of [begin, end) and calls the function for every edge line; blank lines
+    //  and lines starting with '#' or '%' are skipped, anything else must be an edge line
+    template<typename Function>
+    void ParseText(const char* begin, const char* end, Function&& function) {
+        auto is_digit = [](char symbol) {
+            return symbol >= '0' && symbol <= '9';
+        };
+        while (begin < end) {
+            auto line = begin;
+            while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) {
+                ++begin;
+            }
+            if (begin < end && *begin != '\n' && *begin != '#' && *begin != '%') {
+                uint64_t ends[2] = {0, 0};
+                int parsed = 0;
+                for (; parsed < 2 && begin < end && is_digit(*begin); ++parsed) {
+                    while (begin < end && is_digit(*begin)) {
+                        //  saturates just above INT32_MAX, so a long run of digits cannot wrap
+                        ends[parsed] = std::min<uint64_t>(ends[parsed] * 10 + (*begin - '0'),
+                                                          uint64_t{INT32_MAX} + 1);
+                        ++begin;
+                    }
+                    while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == ',')) {
+                        ++begin;
+                    }
+                }
+                if (parsed != 2 || ends[0] > INT32_MAX || ends[1] > INT32_MAX) {
+                    throw MalformedLine{line};
+                }
+                function(static_cast<int>(ends[0]), static_cast<int>(ends[1]));
+            }
+            auto line_end = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            begin = line_end ? line_end + 1 : end;
+        }
+    }
+}
+
+
+//  parses the file in parallel chunks straight into one preallocated vector:
+//  text is scanned twice (count, then fill at known offsets), binary is copied
+inline std::vector<std::pair<int, int>> ReadEdgeList(
+        const std::string& path, EdgeListFormat format, unsigned threads = edge_list::DefaultThreads()) {
+    MappedFile file{path};
+    const char* data = file.Data();
+    size_t size = file.Size();
+    std::vector<std::pair<int, int>> edges;
+
+    if (format == EdgeListFormat::Binary) {
+        if (size % (2 * sizeof(uint32_t))) {
+            throw std::runtime_error("binary edge list size is not a multiple of 8");
+        }
+        edges.resize(size / (2 * sizeof(uint32_t)));
+        std::atomic<bool> malformed{false};
+        edge_list::ParallelFor(threads, [&](unsigned thread) {
+            size_t begin = edges.size() / threads * thread;
+            size_t end = thread + 1 == threads ? edges.size() : edges.size() / threads * (thread + 1);
+            for (size_t idx = begin; idx < end; ++idx) {
+                uint32_t ends[2];
+                std::memcpy(ends, data + idx * sizeof(ends), sizeof(ends));
+                if (ends[0] > INT32_MAX || ends[1] > INT32_MAX) {
+                    malformed = true;
+                }
+                edges[idx] = {static_cast<int>(ends[0]), static_cast<int>(ends[1])};
+            }
+        });
+        if (malformed) {
+            throw std::runtime_error("vertex id does not fit into int");
+        }
+        return edges;
+    }
+
+    auto borders = edge_list::TextChunks(data, size, threads);
+    std::vector<size_t> offsets(threads + 1);
+    std::vector<std::exception_ptr> errors(threads);
+    edge_list::ParallelFor(threads, [&](unsigned thread) {
+        try {
+            edge_list::ParseText(data + borders[thread], data + borders[thread + 1], [&](int, int) {
+                ++offsets[thread + 1];
+            });
+        } catch (...) {
+            errors[thread] = std::current_exception();
+        }
+    });
+    for (auto& error : errors) {
+        if (!error) {
+            continue;
+        }
+        try {
+            std::rethrow_exception(error);
+        } catch (const edge_list::MalformedLine& malformed) {
+            auto line = 1 + std::count(data, malformed.line, '\n');
+            throw std::runtime_error("malformed edge line " + std::to_string(line) + " in " + path);
+        }
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    edges.resize(offsets.back());
+    edge_list::ParallelFor(threads, [&](unsigned thread) {
+        auto out = edges.begin() + offsets[thread];
+        edge_list::ParseText(data + borders[thread], data + borders[thread + 1], [&](int u_num, int v_num) {
+            *out++ = {u_num, v_num};
+        });
+    });
+    return edges;
+}
+
+//  orients every edge as (min, max), sorts chunks in parallel, merges them pairwise
+//  and drops repeats, so "u v" and "v u" lines collapse into one edge
+inline void NormalizeEdgeList(
+        std::vector<std::pair<int, int>>& edges, unsigned threads = edge_list::DefaultThreads()) {
+    std::vector<size_t> borders(threads + 1);
+    for (unsigned idx = 0; idx <= threads; ++idx) {
+        borders[idx] = edges.size() / threads * idx;
+    }
+    borders[threads] = edges.size();
+
+    edge_list::ParallelFor(threads, [&](unsigned thread) {
+        auto begin = edges.begin() + borders[thread];
+        auto end = edges.begin() + borders[thread + 1];
+        for (auto iter = begin; iter != end; ++iter) {
+            if (iter->first > iter->second) {
+                std::swap(iter->first, iter->second);
+            }
+        }
+        std::sort(begin, end);
+    });
+
+    for (size_t width = 1; width < threads; width *= 2) {
+        std::vector<std::thread> workers;
+        for (size_t idx = 0; idx + width < threads; idx += 2 * width) {
+            auto begin = edges.begin() + borders[idx];
+            auto middle = edges.begin() + borders[idx + width];
+            auto end = edges.begin() + borders[std::min<size_t>(idx + 2 * width, threads)];
+            workers.emplace_back([begin, middle, end] {
+                std::inplace_merge(begin, middle, end);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
+
+//  concurrent disjoint set union: roots are only ever linked below a larger index with
+//  a compare-and-swap, so threads share one parent array and an edge closes a cycle
+//  exactly when its ends already have the same root
+inline bool IsForest(
+        int vertex_count, std::span<const std::pair<int, int>> edges,
+        unsigned threads = edge_list::DefaultThreads()) {
+    std::vector<std::atomic<int>> parent(vertex_count);
+    for (int v_num = 0; v_num < vertex_count; ++v_num) {
+        parent[v_num].store(v_num, std::memory_order_relaxed);
+    }
+    auto find = [&](int v_num) {
+        while (true) {
+            int up = parent[v_num].load(std::memory_order_relaxed);
+            if (up == v_num) {
+                return v_num;
+            }
+            int grand = parent[up].load(std::memory_order_relaxed);
+            parent[v_num].compare_exchange_weak(up, grand, std::memory_order_relaxed);
+            v_num = grand;
+        }
+    };
+
+    std::atomic<bool> forest{true};
+    edge_list::ParallelFor(threads, [&](unsigned thread) {
+        size_t begin = edges.size() / threads * thread;
+        size_t end = thread + 1 == threads ? edges.size() : edges.size() / threads * (thread + 1);
+        for (size_t idx = begin; idx < end && forest.load(std::memory_order_relaxed); ++idx) {
+            auto [u_num, v_num] = edges[idx];
+            if (u_num < 0 || v_num < 0 || u_num >= vertex_count || v_num >= vertex_count) {
+                forest = false;
+                return;
+            }
+            while (true) {
+                int u_root = find(u_num);
+                int v_root = find(v_num);
+                if (u_root == v_root) {
+                    forest = false;
+                    return;
+                }
+                if (u_root > v_root) {
+                    std::swap(u_root, v_root);
+                }
+                if (parent[u_root].compare_exchange_strong(u_root, v_root, std::memory_order_acq_rel)) {
+                    break;
+                }
+            }
+        }
+    });
+    return forest;
+}
+
+//  vertex_count < 0 means "largest id in the file plus one"
+inline DynamicForest LoadForest(
+        const std::string& path, EdgeListFormat format, int vertex_count = -1,
+        unsigned threads = edge_list::DefaultThreads()) {
+    auto edges = ReadEdgeList(path, format, threads);
+    NormalizeEdgeList(edges, threads);
+    if (vertex_count < 0) {
+        vertex_count = edges.empty() ? 0 : 1 + std::max_element(
+            edges.begin(), edges.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.second < rhs.second;
+            })->second;
+    }
+    if (!IsForest(vertex_count, edges, threads)) {
+        throw std::runtime_error(path + " is not a forest on " + std::to_string(vertex_count) + " vertices");
+    }
+    return DynamicForest::Build(vertex_count, edges);
+}
+
+#endif //DYNAMIC_FOREST_EDGE_LIST_LOADER_H
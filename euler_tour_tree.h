@@ -8,7 +8,14 @@
 #include <unordered_map>
 #include <algorithm>
 #include <list>
+#include <span>
+#include <array>
 
+#include "component_events.h"
+#include "edge_expiry.h"
+#include "forest_history.h"
+#include "forest_transaction.h"
+#include "tour_selection.h"
 #include "treap.h"
 
 struct Edge {
@@ -20,6 +27,18 @@ struct Edge {
     }
 };
 
+//  an arc of the Euler tour. The representative arc of every vertex is marked and each treap
+//  vertex counts the marks in its subtree, so the vertices of a tour can be selected by rank;
+//  see tour_selection.h
+struct TourArc : Edge {
+    uint32_t marked{};
+    uint32_t marks{};
+
+    void Aggregate(const TourArc* left, const TourArc* right) {
+        marks = marked + (left ? left->marks : 0) + (right ? right->marks : 0);
+    }
+};
+
 
 class DynamicForest {
 public:
@@ -28,49 +47,311 @@ public:
         graph_.assign(size_, {});
     }
 
+    //  bulk construction for edges known to form a forest without repeats: the tours are
+    //  written out by one DFS and every tree becomes a treap in linear time
+    static DynamicForest Build(
+            int vertex_count, std::span<const std::pair<int, int>> edges, const uint32_t seed = 1337) {
+        DynamicForest forest{vertex_count, seed};
+        forest.BuildTours(edges);
+        return forest;
+    }
+
     int GetComponentsNumber() const {
         return size_ - static_cast<int>(edges_.size() / 2);
     }
 
+    //  ids below this bound are valid, including removed vertices waiting for reuse
+    int VertexIdBound() const {
+        return static_cast<int>(graph_.size());
+    }
+
+    bool HasEdge(int u_num, int v_num) const {
+        return edges_.contains(EncodeEdge({u_num, v_num}));
+    }
+
+    int AddVertex() {
+        ++size_;
+        if (!free_vertices_.empty()) {
+            int v_num = free_vertices_.back();
+            free_vertices_.pop_back();
+            transaction_.Log({UndoEntry::Kind::VertexReused, v_num});
+            return v_num;
+        }
+        graph_.emplace_back();
+        history_.AddVertex();
+        events_.AddVertex();
+        transaction_.Log({UndoEntry::Kind::VertexAppended});
+        return static_cast<int>(graph_.size()) - 1;
+    }
+
+    void RemoveVertex(int v_num) {
+        history_.NextVersion();
+        std::vector<int> neighbours(graph_[v_num].begin(), graph_[v_num].end());
+        Component whole{};
+        if (events_.Subscribed() && !neighbours.empty()) {
+            whole = Locate(v_num);
+        }
+
+        std::vector<std::pair<TreapVertex<TourArc>*, TreapVertex<TourArc>*>> arcs;
+        arcs.reserve(neighbours.size());
+        for (auto u_num : neighbours) {
+            arcs.emplace_back(
+                &edges_[EncodeEdge({v_num, u_num})],
+                &edges_[EncodeEdge({u_num, v_num})]
+            );
+        }
+        ChangeTreaps([&](auto&& observer) {
+            RemoveEdges(arcs, observer);
+        });
+
+        for (auto u_num : neighbours) {
+            EraseArc(v_num, EncodeEdge({v_num, u_num}));
+            EraseArc(u_num, EncodeEdge({u_num, v_num}));
+        }
+        if (whole.root) {
+            neighbours.push_back(v_num);
+            SplitComponent(whole, neighbours);
+        }
+
+        if (history_.Enabled()) {
+            RecordRepresentative(v_num);
+            for (auto u_num : neighbours) {
+                RecordRepresentative(u_num);
+            }
+        }
+
+        free_vertices_.push_back(v_num);
+        --size_;
+        transaction_.Log({UndoEntry::Kind::VertexRemoved, v_num});
+    }
+
     void AddEdge(int u_num, int v_num) {
+        history_.NextVersion();
         auto encode_forward = EncodeEdge({u_num, v_num});
         auto encode_backward = EncodeEdge({v_num, u_num});
+        Component u_whole{};
+        Component v_whole{};
+        if (events_.Subscribed()) {
+            u_whole = Locate(u_num);
+            v_whole = Locate(v_num);
+        }
 
-        edges_[encode_forward] = CreateTreapVertex({u_num, v_num});
-        edges_[encode_backward] = CreateTreapVertex({v_num, u_num});
+        //  the new arcs go to the front of both lists, so they become the representatives
+        edges_[encode_forward] = CreateTreapVertex({u_num, v_num}, true);
+        edges_[encode_backward] = CreateTreapVertex({v_num, u_num}, true);
 
-        AddEdge(
-            GetVirtualVertex(u_num),
-            GetVirtualVertex(v_num),
-            &edges_[encode_forward],
-            &edges_[encode_backward]
-        );
+        ChangeTreaps([&](auto&& observer) {
+            observer.Touch(&edges_[encode_forward]);
+            observer.Touch(&edges_[encode_backward]);
+            AddEdge(
+                GetVirtualVertex(u_num),
+                GetVirtualVertex(v_num),
+                &edges_[encode_forward],
+                &edges_[encode_backward],
+                observer
+            );
+        });
 
         graph_[u_num].push_front(v_num);
         graph_[v_num].push_front(u_num);
-        list_iter_edges_[encode_forward] = graph_[u_num].begin();
-        list_iter_edges_[encode_backward] = graph_[v_num].begin();
+        arc_slots_[encode_forward] = {graph_[u_num].begin()};
+        arc_slots_[encode_backward] = {graph_[v_num].begin()};
+        if (events_.Subscribed()) {
+            events_.Merge(u_whole, v_whole, Locate(u_num));
+        }
+
+        transaction_.Log({UndoEntry::Kind::ArcAdded, u_num, encode_forward});
+        transaction_.Log({UndoEntry::Kind::ArcAdded, v_num, encode_backward});
+
+        if (history_.Enabled()) {
+            RecordRepresentative(u_num);
+            RecordRepresentative(v_num);
+        }
     }
 
     void RemoveEdge(int u_num, int v_num) {
+        history_.NextVersion();
         auto encode_forward = EncodeEdge({u_num, v_num});
         auto encode_backward = EncodeEdge({v_num, u_num});
 
-        TreapVertex<Edge>* edge_f = &edges_[encode_forward];
-        TreapVertex<Edge>* edge_b = &edges_[encode_backward];
+        TreapVertex<TourArc>* edge_f = &edges_[encode_forward];
+        TreapVertex<TourArc>* edge_b = &edges_[encode_backward];
+        Component whole{};
+        if (events_.Subscribed()) {
+            whole = Locate(u_num);
+        }
+
+        ChangeTreaps([&](auto&& observer) {
+            RemoveEdge(edge_f, edge_b, observer);
+        });
+
+        EraseArc(u_num, encode_forward);
+        EraseArc(v_num, encode_backward);
+        if (events_.Subscribed()) {
+            SplitComponent(whole, std::array{u_num, v_num});
+        }
+
+        if (history_.Enabled()) {
+            RecordRepresentative(u_num);
+            RecordRepresentative(v_num);
+        }
+    }
+
+    //  an edge that AdvanceTime removes once the time reaches expiry; its forward arc's slot
+    //  carries the timer, so removing the edge by hand earlier stops it. See EdgeExpiry
+    void AddEdge(int u_num, int v_num, uint64_t expiry) {
+        assert(!transaction_.Active());
+        auto encode_forward = EncodeEdge({u_num, v_num});
+        AddEdge(u_num, v_num);
+        arc_slots_.find(encode_forward)->second.timer = expiry_.Start(
+            expiry, &edges_.find(encode_forward)->second,
+            &edges_.find(EncodeEdge({v_num, u_num}))->second);
+    }
+
+    uint64_t Now() const {
+        return expiry_.Now();
+    }
+
+    //  removes every edge whose expiry is at most the new time, all in one batched cut as in
+    //  RemoveVertex; returns how many edges expired
+    size_t AdvanceTime(uint64_t time) {
+        assert(!transaction_.Active());
+        if (!expiry_.Advance(time)) {
+            return 0;
+        }
+        const auto& expired = expiry_.Expired();
+
+        //  a batch would split many components at once, events want them one by one
+        if (events_.Subscribed()) {
+            for (auto [u_num, v_num] : expired) {
+                RemoveEdge(u_num, v_num);
+            }
+            return expired.size();
+        }
+
+        history_.NextVersion();
+        ChangeTreaps([&](auto&& observer) {
+            RemoveEdges(expiry_.ExpiredArcs(), observer);
+        });
+        for (auto [u_num, v_num] : expired) {
+            EraseArc(u_num, EncodeEdge({u_num, v_num}));
+            EraseArc(v_num, EncodeEdge({v_num, u_num}));
+        }
+        if (history_.Enabled()) {
+            for (auto [u_num, v_num] : expired) {
+                RecordRepresentative(u_num);
+                RecordRepresentative(v_num);
+            }
+        }
+        return expired.size();
+    }
+
+    //  until Commit or Rollback every change of a treap link, size or mark is logged together with
+    //  the bookkeeping around it, so Rollback replays the log backwards without any rebalancing;
+    //  see ForestTransaction
+    void Begin() {
+        assert(!history_.Enabled());
+        transaction_.Begin(history_.Version(), rng_);
+        events_.Begin();
+    }
+
+    void Commit() {
+        transaction_.Commit();
+        events_.Commit();
+    }
+
+    void Rollback() {
+        assert(transaction_.Active());
+        //  the ids go back first, the undo of an appended vertex drops its id
+        events_.Rollback();
+        transaction_.Rollback([this](const UndoEntry& entry) {
+            Undo(entry);
+        });
+        history_.ResetVersion(transaction_.StartVersion());
+        rng_ = transaction_.StartRng();
+    }
+
+    bool InTransaction() const {
+        return transaction_.Active();
+    }
+
+    //  from now on every AddEdge/RemoveEdge/RemoveVertex creates a version that stays queryable,
+    //  at the cost of the O(log n) links each update rewires; see ForestHistory
+    void EnablePersistence() {
+        assert(!transaction_.Active());
+        if (history_.Enabled()) {
+            return;
+        }
+        history_.Enable(edges_, VertexIdBound(), [this](int v_num) {
+            return GetVirtualVertex(v_num);
+        });
+    }
+
+    uint64_t Version() const {
+        return history_.Version();
+    }
+
+    uint64_t OldestVersion() const {
+        return history_.OldestVersion();
+    }
+
+    bool IsConnectedAt(int u_num, int v_num, uint64_t version) const {
+        return history_.IsConnectedAt(u_num, v_num, version);
+    }
+
+    //  forgets everything needed only by versions older than the given one
+    void ReleaseVersionsBefore(uint64_t version) {
+        history_.ReleaseVersionsBefore(version);
+    }
+
+    //  from now on every merge and split is pushed to the ring as it happens, each costing
+    //  O(log n) next to the update; ids and transactions work as described at ComponentEvents.
+    //  A removed vertex stays a single-vertex component, with its id, until it is reused;
+    //  a vertex appended later is a single-vertex component under an id not seen before.
+    void Subscribe(ComponentEventRing* events) {
+        assert(!transaction_.Active());
+        events_.Subscribe(events, VertexIdBound(), [this](int v_num) {
+            return Locate(v_num);
+        });
+    }
 
-        RemoveEdge(edge_f, edge_b);
+    void Unsubscribe() {
+        assert(!transaction_.Active());
+        events_.Unsubscribe();
+    }
 
-        auto iter_f = list_iter_edges_[encode_forward];
-        auto iter_b = list_iter_edges_[encode_backward];
-        graph_[u_num].erase(iter_f);
-        graph_[v_num].erase(iter_b);
+    //  the id the events use for v's component; only while subscribed
+    uint64_t ComponentId(int v_num) {
+        assert(events_.Subscribed());
+        return events_.IdOf(Locate(v_num));
+    }
+
+    int ComponentSize(int v_num) {
+        return static_cast<int>(Locate(v_num).size);
+    }
 
-        edges_.erase(encode_forward);
-        edges_.erase(encode_backward);
+    //  the k-th vertex of v's component, counting from 0 in the order of its Euler tour;
+    //  the order is stable until the next update
+    int KthInComponent(int v_num, uint32_t k) {
+        auto vertex = GetVirtualVertex(v_num);
+        if (!vertex) {
+            assert(k == 0);
+            return v_num;
+        }
+        return tour_selection::Kth(treap::GetTreapRoot(vertex), k);
+    }
+
+    //  the position of v in the order of KthInComponent
+    uint32_t RankInComponent(int v_num) {
+        auto vertex = GetVirtualVertex(v_num);
+        return vertex ? tour_selection::Rank(vertex) : 0;
+    }
 
-        list_iter_edges_.erase(encode_forward);
-        list_iter_edges_.erase(encode_backward);
+    //  a uniformly random vertex of v's component
+    template<typename Rng>
+    int SampleVertex(int v_num, Rng& rng) {
+        auto size = static_cast<uint32_t>(ComponentSize(v_num));
+        return KthInComponent(v_num, std::uniform_int_distribution<uint32_t>{0, size - 1}(rng));
     }
 
     bool IsConnected(int u_num, int v_num) {
@@ -84,6 +365,58 @@ public:
         }
         return treap::GetTreapRoot(v_vertex) == treap::GetTreapRoot(u_vertex);
     }
+
+    struct TourRange {
+        treap::TreapIterator<TourArc> first;
+        treap::TreapIterator<TourArc> last;
+
+        treap::TreapIterator<TourArc> begin() const {
+            return first;
+        }
+
+        treap::TreapIterator<TourArc> end() const {
+            return last;
+        }
+    };
+
+    //  arcs of the Euler tour of v's component, in tour order; valid until the next update
+    TourRange ComponentTour(int v_num) {
+        auto root = treap::GetTreapRoot(GetVirtualVertex(v_num));
+        return {treap::TreapIterator<TourArc>{treap::FirstInTreap(root)}, {}};
+    }
+
+    //  a vertex is reported at its representative arc, which is in the tour exactly once
+    template<typename Function>
+    void ForEachVertexInComponent(int v_num, Function&& function) {
+        if (graph_[v_num].empty()) {
+            function(v_num);
+            return;
+        }
+        for (const auto& arc : ComponentTour(v_num)) {
+            if (graph_[arc.from].front() == arc.to) {
+                function(arc.from);
+            }
+        }
+    }
+
+    void IsConnectedBatch(std::span<const std::pair<int, int>> queries, std::span<bool> out) {
+        assert(queries.size() == out.size());
+        std::array<TreapVertex<TourArc>*, 2 * kBatchWidth> roots;
+        for (size_t begin = 0; begin < queries.size(); begin += kBatchWidth) {
+            size_t count = std::min(kBatchWidth, queries.size() - begin);
+            for (size_t idx = 0; idx < count; ++idx) {
+                auto [u_num, v_num] = queries[begin + idx];
+                roots[2 * idx] = GetVirtualVertex(u_num);
+                roots[2 * idx + 1] = GetVirtualVertex(v_num);
+            }
+            treap::GetTreapRoots(roots.data(), 2 * count);
+            for (size_t idx = 0; idx < count; ++idx) {
+                auto [u_num, v_num] = queries[begin + idx];
+                out[begin + idx] = u_num == v_num ||
+                    (roots[2 * idx] && roots[2 * idx] == roots[2 * idx + 1]);
+            }
+        }
+    }
     /*
     void PrintVirtualTree(int v_num) {
         auto root = treap::GetTreapRoot(GetVirtualVertex(v_num));
@@ -93,60 +426,297 @@ public:
     */
 
 private:
-    void AddEdge(TreapVertex<Edge>* u_vertex, TreapVertex<Edge>* v_vertex,
-                 TreapVertex<Edge>* edge_forward, TreapVertex<Edge>* edge_backward) {
-        auto u_subtree = treap::MoveToFirstPos(u_vertex);
-        auto v_subtree = treap::MoveToFirstPos(v_vertex);
-        auto augmented_v_tree = treap::MergeTreap(edge_forward, v_subtree);
-        augmented_v_tree = treap::MergeTreap(augmented_v_tree, edge_backward);
-        treap::MergeTreap(u_subtree, augmented_v_tree);
+    using ArcMap = std::unordered_map<uint64_t, TreapVertex<TourArc>>;
+    using UndoEntry = ForestTransaction<ArcMap>::Entry;
+    using Component = ComponentEvents<TreapVertex<TourArc>>::Component;
+
+    using Expiry = EdgeExpiry<TreapVertex<TourArc>>;
+
+    static constexpr size_t kBatchWidth = 32;
+
+    //  where the arc sits in its owner's adjacency list; the forward arc of a timed edge
+    //  also carries its timer
+    struct ArcSlot {
+        std::list<int>::iterator list_iter;
+        uint32_t timer{Expiry::kNoTimer};
+    };
+
+    template<typename Function>
+    void ChangeTreaps(Function&& function) {
+        if (transaction_.Active()) {
+            function(transaction_.Observer());
+            return;
+        }
+        if (!history_.Enabled()) {
+            function(treap::NoObserver{});
+            return;
+        }
+        function(history_.Observer());
+        history_.RecordTouched();
     }
 
-    void RemoveEdge(TreapVertex<Edge>* edge_one, TreapVertex<Edge>* edge_two) {
-        auto pos_one = treap::PosNumberInTreap(edge_one);
-        auto pos_two = treap::PosNumberInTreap(edge_two);
+    void BuildTours(std::span<const std::pair<int, int>> edges) {
+        struct Slot {
+            int to;
+            TreapVertex<TourArc>* arc;
+            TreapVertex<TourArc>* twin;
+        };
 
-        auto root = treap::GetTreapRoot(edge_one);
-        if (pos_one > pos_two) {
-            std::swap(edge_one, edge_two);
-            std::swap(pos_one, pos_two);
+        auto vertex_count = graph_.size();
+        std::vector<uint32_t> offsets(vertex_count + 1);
+        for (auto [u_num, v_num] : edges) {
+            ++offsets[u_num + 1];
+            ++offsets[v_num + 1];
+        }
+        for (size_t v_num = 0; v_num < vertex_count; ++v_num) {
+            offsets[v_num + 1] += offsets[v_num];
+        }
+
+        std::vector<uint32_t> next_slot(offsets.begin(), offsets.end() - 1);
+        std::vector<Slot> slots(2 * edges.size());
+        edges_.reserve(2 * edges.size());
+        arc_slots_.reserve(2 * edges.size());
+        for (auto [u_num, v_num] : edges) {
+            auto edge_forward = &(edges_[EncodeEdge({u_num, v_num})] = CreateTreapVertex({u_num, v_num}));
+            auto edge_backward = &(edges_[EncodeEdge({v_num, u_num})] = CreateTreapVertex({v_num, u_num}));
+            slots[next_slot[u_num]++] = {v_num, edge_forward, edge_backward};
+            slots[next_slot[v_num]++] = {u_num, edge_backward, edge_forward};
         }
-        auto [mid, right] = treap::SplitTreap(root, pos_two);
-        auto [edge_bb, new_right] = treap::SplitTreap(right, 1);
-        auto [left, new_subtree] = treap::SplitTreap(mid, pos_one);
-        auto [edge_ff, new_subtree_correct] = treap::SplitTreap(new_subtree, 1);
 
-        assert(edge_bb == edge_two);
-        assert(edge_one == edge_ff);
+        for (size_t v_num = 0; v_num < vertex_count; ++v_num) {
+            auto& list = graph_[v_num];
+            for (auto idx = offsets[v_num]; idx < offsets[v_num + 1]; ++idx) {
+                list.push_back(slots[idx].to);
+                arc_slots_[EncodeEdge({static_cast<int>(v_num), slots[idx].to})] = {std::prev(list.end())};
+            }
+            if (offsets[v_num] < offsets[v_num + 1]) {
+                slots[offsets[v_num]].arc->data.marked = 1;
+            }
+        }
 
-        treap::MergeTreap(left, new_right);
+        struct Frame {
+            int vertex;
+            int parent;
+            TreapVertex<TourArc>* arc_up;
+        };
+
+        std::copy(offsets.begin(), offsets.end() - 1, next_slot.begin());
+        std::vector<TreapVertex<TourArc>*> tour;
+        std::vector<Frame> stack;
+        for (size_t root = 0; root < vertex_count; ++root) {
+            if (offsets[root] == offsets[root + 1] || next_slot[root] != offsets[root]) {
+                continue;
+            }
+            tour.clear();
+            stack.push_back({static_cast<int>(root), -1, nullptr});
+            while (!stack.empty()) {
+                auto& frame = stack.back();
+                auto& next = next_slot[frame.vertex];
+                if (next < offsets[frame.vertex + 1]) {
+                    const auto& slot = slots[next++];
+                    if (slot.to != frame.parent) {
+                        tour.push_back(slot.arc);
+                        stack.push_back({slot.to, frame.vertex, slot.twin});
+                    }
+                    continue;
+                }
+                if (frame.arc_up) {
+                    tour.push_back(frame.arc_up);
+                }
+                stack.pop_back();
+            }
+            treap::BuildTreap(tour.data(), tour.size());
+        }
+    }
+
+    void RecordRepresentative(int v_num) {
+        history_.RecordRepresentative(v_num, GetVirtualVertex(v_num));
+    }
+
+    void EraseArc(int owner, uint64_t encoding) {
+        auto slot = arc_slots_.find(encoding);
+        auto list_iter = slot->second.list_iter;
+        bool was_front = list_iter == graph_[owner].begin();
+        auto timer = slot->second.timer;
+        auto expiry = expiry_.Stop(timer);
+        if (transaction_.Active()) {
+            transaction_.Park({UndoEntry::Kind::ArcRemoved, owner, encoding, list_iter, timer, expiry},
+                              graph_[owner], edges_.extract(encoding));
+        } else {
+            graph_[owner].erase(list_iter);
+            if (history_.Enabled()) {
+                history_.Retire(edges_.extract(encoding));
+            } else {
+                edges_.erase(encoding);
+            }
+        }
+        arc_slots_.erase(slot);
+
+        //  the next arc of the owner takes over its mark
+        if (was_front && !graph_[owner].empty()) {
+            auto vertex = GetVirtualVertex(owner);
+            ChangeTreaps([&](auto&& observer) {
+                tour_selection::SetMark(vertex, 1, observer);
+            });
+        }
+    }
+
+    void Undo(const UndoEntry& entry) {
+        switch (entry.kind) {
+            case UndoEntry::Kind::VertexAppended:
+                graph_.pop_back();
+                events_.DropLastVertex();
+                --size_;
+                break;
+            case UndoEntry::Kind::VertexReused:
+                free_vertices_.push_back(entry.owner);
+                --size_;
+                break;
+            case UndoEntry::Kind::VertexRemoved:
+                free_vertices_.pop_back();
+                ++size_;
+                break;
+            case UndoEntry::Kind::ArcAdded:
+                graph_[entry.owner].erase(arc_slots_[entry.encoding].list_iter);
+                arc_slots_.erase(entry.encoding);
+                edges_.erase(entry.encoding);
+                break;
+            case UndoEntry::Kind::ArcRemoved:
+                transaction_.Unpark(entry, graph_[entry.owner], edges_);
+                arc_slots_[entry.encoding] = {entry.list_iter, entry.timer};
+                expiry_.Restore(entry.timer, entry.expiry);
+                break;
+        }
+    }
+
+    template<typename Observer>
+    void AddEdge(TreapVertex<TourArc>* u_vertex, TreapVertex<TourArc>* v_vertex,
+                 TreapVertex<TourArc>* edge_forward, TreapVertex<TourArc>* edge_backward,
+                 Observer&& observer) {
+        Unmark(u_vertex, observer);
+        Unmark(v_vertex, observer);
+        treap::LinkTours(u_vertex, v_vertex, edge_forward, edge_backward, observer);
+    }
+
+    template<typename Observer>
+    void RemoveEdge(TreapVertex<TourArc>* edge_one, TreapVertex<TourArc>* edge_two, Observer&& observer) {
+        treap::CutTour(edge_one, edge_two, observer);
+    }
+
+    //  cuts every pair of twin arcs at once: positions are taken before any split,
+    //  then each tour is cut right to left and the pieces between nested twins are glued back
+    template<typename Observer>
+    void RemoveEdges(const std::vector<std::pair<TreapVertex<TourArc>*, TreapVertex<TourArc>*>>& arcs,
+                     Observer&& observer) {
+        struct ArcPosition {
+            TreapVertex<TourArc>* root;
+            uint32_t pos;
+            size_t edge_idx;
+        };
+
+        std::vector<ArcPosition> positions;
+        positions.reserve(2 * arcs.size());
+        for (size_t idx = 0; idx < arcs.size(); ++idx) {
+            auto [root, pos_one, pos_two] = treap::RootAndPositions(arcs[idx].first, arcs[idx].second);
+            positions.push_back({root, pos_one, idx});
+            positions.push_back({root, pos_two, idx});
+        }
+        std::sort(positions.begin(), positions.end(), [](const auto& lhs, const auto& rhs) {
+            if (lhs.root != rhs.root) {
+                return lhs.root < rhs.root;
+            }
+            return lhs.pos < rhs.pos;
+        });
+
+        std::vector<TreapVertex<TourArc>*> pieces;
+        std::vector<TreapVertex<TourArc>*> open_tours;
+        std::vector<bool> opened(arcs.size());
+        for (size_t begin = 0, end = 0; begin < positions.size(); begin = end) {
+            auto root = positions[begin].root;
+            while (end < positions.size() && positions[end].root == root) {
+                ++end;
+            }
+
+            pieces.assign(end - begin + 1, nullptr);
+            for (size_t idx = end; idx > begin; --idx) {
+                auto [rest, tail] = treap::SplitTreap(root, positions[idx - 1].pos, observer);
+                auto [arc, piece] = treap::SplitTreap(tail, 1, observer);
+                pieces[idx - begin] = piece;
+                root = rest;
+            }
+            pieces[0] = root;
+
+            open_tours.assign(1, pieces[0]);
+            for (size_t idx = begin; idx < end; ++idx) {
+                auto edge_idx = positions[idx].edge_idx;
+                if (!opened[edge_idx]) {
+                    opened[edge_idx] = true;
+                    open_tours.push_back(nullptr);
+                } else {
+                    open_tours.pop_back();
+                }
+                open_tours.back() = treap::MergeTreap(
+                    open_tours.back(), pieces[idx - begin + 1], observer);
+            }
+        }
     }
 
-    TreapVertex<Edge>* GetVirtualVertex(int v_num) {
+    //  a tour has 2(k - 1) arcs for k vertices
+    Component Locate(int v_num) {
+        auto vertex = GetVirtualVertex(v_num);
+        if (!vertex) {
+            return {nullptr, v_num, 1};
+        }
+        auto root = treap::GetTreapRoot(vertex);
+        return {root, v_num, root->size_of_treap / 2 + 1};
+    }
+
+    //  whole was located before the cut; every piece contains one of the given vertices
+    void SplitComponent(const Component& whole, std::span<const int> vertices) {
+        events_.Split(whole, vertices, [this](int v_num) {
+            return Locate(v_num);
+        });
+    }
+
+    TreapVertex<TourArc>* GetVirtualVertex(int v_num) {
         if (graph_[v_num].empty()) {
             return nullptr;
         }
         auto u_num = graph_[v_num].front();
         auto encoding = EncodeEdge({v_num, u_num});
-        TreapVertex<Edge>& ref = (edges_[encoding]);
+        TreapVertex<TourArc>& ref = (edges_[encoding]);
         return &ref;
     }
 
-    TreapVertex<Edge> CreateTreapVertex(Edge edge) {
-        TreapVertex<Edge> vertex{edge};
+    TreapVertex<TourArc> CreateTreapVertex(Edge edge, bool marked = false) {
+        TreapVertex<TourArc> vertex{TourArc{edge, marked, marked}};
         vertex.treap_priority = rng_();
         return vertex;
     }
 
-    uint64_t EncodeEdge(const Edge& edge) const {
-        return edge.from * static_cast<uint64_t>(size_) + edge.to;
+    template<typename Observer>
+    static void Unmark(TreapVertex<TourArc>* vertex, Observer&& observer) {
+        if (vertex) {
+            tour_selection::SetMark(vertex, 0, observer);
+        }
+    }
+
+    static uint64_t EncodeEdge(const Edge& edge) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(edge.from)) << 32) |
+            static_cast<uint32_t>(edge.to);
     }
-    
+
     int size_{};
     std::vector<std::list<int>> graph_{};
-    std::unordered_map<uint64_t, TreapVertex<Edge>> edges_{};
-    std::unordered_map<uint64_t, std::list<int>::iterator> list_iter_edges_;
+    std::vector<int> free_vertices_{};
+    ArcMap edges_{};
+    std::unordered_map<uint64_t, ArcSlot> arc_slots_;
     std::mt19937 rng_{};
+
+    ForestHistory<ArcMap> history_{};
+    ForestTransaction<ArcMap> transaction_{};
+    ComponentEvents<TreapVertex<TourArc>> events_{};
+    Expiry expiry_{};
 };
 
 #endif //DYNAMIC_FOREST_EULER_TOUR_TREE_H
@@ -0,0 +1,186 @@
+#ifndef DYNAMIC_FOREST_FOREST_HISTORY_H
+#define DYNAMIC_FOREST_FOREST_HISTORY_H
+
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <iterator>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//  the versions of a persistent DynamicForest. Once enabled, each arc keeps the history of its
+//  ancestor link and each vertex the history of its representative arc, so an update costs the
+//  O(log n) links it rewires and a past root is found by walking the links as they were.
+//  ArcMap is the map owning the arcs: an arc erased while older versions still see it is retired
+//  here with its map node, which keeps its address valid until those versions are released.
+template<typename ArcMap>
+class ForestHistory {
+public:
+    using Vertex = typename ArcMap::mapped_type;
+
+    //  the treap observer of a recorded update: collects the arcs whose links may change
+    struct Recorder {
+        std::vector<Vertex*>* touched;
+
+        void Touch(Vertex* vertex) {
+            touched->push_back(vertex);
+        }
+    };
+
+    bool Enabled() const {
+        return enabled_;
+    }
+
+    uint64_t Version() const {
+        return version_;
+    }
+
+    uint64_t OldestVersion() const {
+        return oldest_version_;
+    }
+
+    //  every update makes a version, recorded or not
+    void NextVersion() {
+        ++version_;
+    }
+
+    //  a rolled back transaction takes its versions back; transactions are never recorded
+    void ResetVersion(uint64_t version) {
+        assert(!enabled_ && version <= version_);
+        version_ = version;
+    }
+
+    //  the present becomes the oldest version; representative(v) is v's representative arc
+    template<typename Representative>
+    void Enable(ArcMap& arcs, int vertex_count, Representative&& representative) {
+        enabled_ = true;
+        oldest_version_ = version_;
+        for (auto& [encoding, vertex] : arcs) {
+            ancestor_history_[&vertex].emplace_back(version_, vertex.ancestor);
+        }
+        representative_history_.assign(vertex_count, {});
+        for (int v_num = 0; v_num < vertex_count; ++v_num) {
+            RecordRepresentative(v_num, representative(v_num));
+        }
+    }
+
+    void AddVertex() {
+        if (enabled_) {
+            representative_history_.emplace_back();
+        }
+    }
+
+    Recorder Observer() {
+        return {&touched_};
+    }
+
+    //  after an update seen through Observer: the new links of the touched arcs
+    void RecordTouched() {
+        for (auto vertex : touched_) {
+            auto& history = ancestor_history_[vertex];
+            if (!history.empty() && history.back().second == vertex->ancestor) {
+                continue;
+            }
+            if (!history.empty() && history.back().first == version_) {
+                history.back().second = vertex->ancestor;
+            } else {
+                history.emplace_back(version_, vertex->ancestor);
+            }
+        }
+        touched_.clear();
+    }
+
+    void RecordRepresentative(int v_num, Vertex* vertex) {
+        auto& history = representative_history_[v_num];
+        if (history.empty() ? vertex != nullptr : history.back().second != vertex) {
+            history.emplace_back(version_, vertex);
+        }
+    }
+
+    void Retire(typename ArcMap::node_type node) {
+        retired_arcs_.emplace_back(version_, std::move(node));
+    }
+
+    bool IsConnectedAt(int u_num, int v_num, uint64_t version) const {
+        assert(enabled_ && oldest_version_ <= version && version <= version_);
+        if (u_num == v_num) {
+            return true;
+        }
+        auto u_vertex = RepresentativeAt(u_num, version);
+        auto v_vertex = RepresentativeAt(v_num, version);
+        if (!u_vertex || !v_vertex) {
+            return false;
+        }
+        return GetTreapRootAt(u_vertex, version) == GetTreapRootAt(v_vertex, version);
+    }
+
+    //  forgets everything needed only by versions older than the given one
+    void ReleaseVersionsBefore(uint64_t version) {
+        assert(enabled_ && version <= version_);
+        if (version <= oldest_version_) {
+            return;
+        }
+        oldest_version_ = version;
+
+        size_t released = 0;
+        while (released < retired_arcs_.size() && retired_arcs_[released].first <= version) {
+            ancestor_history_.erase(&retired_arcs_[released].second.mapped());
+            ++released;
+        }
+        retired_arcs_.erase(retired_arcs_.begin(), retired_arcs_.begin() + released);
+
+        for (auto& [vertex, history] : ancestor_history_) {
+            DropHistoryBefore(history, version);
+        }
+        for (auto& history : representative_history_) {
+            DropHistoryBefore(history, version);
+        }
+    }
+
+private:
+    using VersionedArc = std::pair<uint64_t, Vertex*>;
+
+    static Vertex* VersionLookup(const std::vector<VersionedArc>& history, uint64_t version) {
+        auto iter = std::upper_bound(
+            history.begin(), history.end(), version,
+            [](uint64_t value, const VersionedArc& entry) { return value < entry.first; });
+        if (iter == history.begin()) {
+            return nullptr;
+        }
+        return std::prev(iter)->second;
+    }
+
+    static void DropHistoryBefore(std::vector<VersionedArc>& history, uint64_t version) {
+        auto iter = std::upper_bound(
+            history.begin(), history.end(), version,
+            [](uint64_t value, const VersionedArc& entry) { return value < entry.first; });
+        if (iter != history.begin()) {
+            history.erase(history.begin(), std::prev(iter));
+        }
+    }
+
+    Vertex* RepresentativeAt(int v_num, uint64_t version) const {
+        if (v_num >= static_cast<int>(representative_history_.size())) {
+            return nullptr;
+        }
+        return VersionLookup(representative_history_[v_num], version);
+    }
+
+    Vertex* GetTreapRootAt(Vertex* vertex, uint64_t version) const {
+        while (auto ancestor = VersionLookup(ancestor_history_.at(vertex), version)) {
+            vertex = ancestor;
+        }
+        return vertex;
+    }
+
+    bool enabled_{false};
+    uint64_t version_{};
+    uint64_t oldest_version_{};
+    std::vector<Vertex*> touched_{};
+    std::unordered_map<Vertex*, std::vector<VersionedArc>> ancestor_history_{};
+    std::vector<std::vector<VersionedArc>> representative_history_{};
+    std::vector<std::pair<uint64_t, typename ArcMap::node_type>> retired_arcs_{};
+};
+
+#endif //DYNAMIC_FOREST_FOREST_HISTORY_H
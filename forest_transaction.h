@@ -0,0 +1,147 @@
+#ifndef DYNAMIC_FOREST_FOREST_TRANSACTION_H
+#define DYNAMIC_FOREST_FOREST_TRANSACTION_H
+
+#include <cassert>
+#include <cinttypes>
+#include <iterator>
+#include <list>
+#include <random>
+#include <utility>
+#include <vector>
+
+//  the undo log of a DynamicForest transaction. Every treap vertex seen through Observer is
+//  saved before it changes and every change of the bookkeeping around the treaps is logged as an
+//  Entry, so Rollback restores the saved vertices and replays the entries backwards without any
+//  rebalancing. An arc erased inside the transaction is parked with its adjacency list element
+//  and its map node instead of being freed, so putting it back keeps every pointer to it valid.
+template<typename ArcMap>
+class ForestTransaction {
+public:
+    using Vertex = typename ArcMap::mapped_type;
+
+    struct Entry {
+        enum class Kind : uint8_t {
+            VertexAppended,
+            VertexReused,
+            VertexRemoved,
+            ArcAdded,
+            ArcRemoved,
+        };
+
+        Kind kind;
+        int owner{};
+        uint64_t encoding{};
+        std::list<int>::iterator list_iter{};
+        //  the timer of a removed timed arc and the expiry it held
+        uint32_t timer{};
+        uint64_t expiry{};
+        std::list<int>::iterator next_iter{};
+        bool last_in_list{};
+    };
+
+    struct Snapshot {
+        Vertex* vertex;
+        Vertex* ancestor;
+        Vertex* left_son;
+        Vertex* right_son;
+        uint32_t size_of_treap;
+        decltype(Vertex::data) data;
+    };
+
+    //  the treap observer inside a transaction
+    struct Recorder {
+        std::vector<Snapshot>* log;
+
+        void Touch(Vertex* vertex) {
+            log->push_back({vertex, vertex->ancestor, vertex->left_son, vertex->right_son,
+                            vertex->size_of_treap, vertex->data});
+        }
+    };
+
+    bool Active() const {
+        return active_;
+    }
+
+    //  the version and the generator to return to on Rollback
+    void Begin(uint64_t version, const std::mt19937& rng) {
+        assert(!active_);
+        active_ = true;
+        start_version_ = version;
+        start_rng_ = rng;
+    }
+
+    uint64_t StartVersion() const {
+        return start_version_;
+    }
+
+    const std::mt19937& StartRng() const {
+        return start_rng_;
+    }
+
+    Recorder Observer() {
+        return {&treap_log_};
+    }
+
+    void Log(const Entry& entry) {
+        if (active_) {
+            undo_log_.push_back(entry);
+        }
+    }
+
+    //  an arc erased from owner's list and from the arc map inside the transaction
+    void Park(Entry entry, std::list<int>& list, typename ArcMap::node_type node) {
+        entry.next_iter = std::next(entry.list_iter);
+        entry.last_in_list = entry.next_iter == list.end();
+        undo_log_.push_back(entry);
+        detached_arcs_.splice(detached_arcs_.end(), list, entry.list_iter);
+        detached_arc_nodes_.push_back(std::move(node));
+    }
+
+    //  puts the arc of an ArcRemoved entry back; entries are undone newest first
+    void Unpark(const Entry& entry, std::list<int>& list, ArcMap& arcs) {
+        auto position = entry.last_in_list ? list.end() : entry.next_iter;
+        list.splice(position, detached_arcs_, entry.list_iter);
+        arcs.insert(std::move(detached_arc_nodes_.back()));
+        detached_arc_nodes_.pop_back();
+    }
+
+    void Commit() {
+        assert(active_);
+        active_ = false;
+        treap_log_.clear();
+        undo_log_.clear();
+        detached_arcs_.clear();
+        detached_arc_nodes_.clear();
+    }
+
+    //  undo(entry) reverts one entry of the bookkeeping, after the treaps are restored
+    template<typename Undo>
+    void Rollback(Undo&& undo) {
+        assert(active_);
+        active_ = false;
+        for (auto iter = treap_log_.rbegin(); iter != treap_log_.rend(); ++iter) {
+            auto vertex = iter->vertex;
+            vertex->ancestor = iter->ancestor;
+            vertex->left_son = iter->left_son;
+            vertex->right_son = iter->right_son;
+            vertex->size_of_treap = iter->size_of_treap;
+            vertex->data = iter->data;
+        }
+        for (auto iter = undo_log_.rbegin(); iter != undo_log_.rend(); ++iter) {
+            undo(*iter);
+        }
+        treap_log_.clear();
+        undo_log_.clear();
+    }
+
+private:
+    bool active_{false};
+    uint64_t start_version_{};
+    std::mt19937 start_rng_{};
+    std::vector<Snapshot> treap_log_{};
+    std::vector<Entry> undo_log_{};
+    std::list<int> detached_arcs_{};
+    std::vector<typename ArcMap::node_type> detached_arc_nodes_{};
+};
+
+#endif //DYNAMIC_FOREST_FOREST_TRANSACTION_H
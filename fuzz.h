@@ -0,0 +1,179 @@
+#ifndef DYNAMIC_FOREST_FUZZ_H
+#define DYNAMIC_FOREST_FUZZ_H
+
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "euler_tour_tree.h"
+#include "reference_forest.h"
+
+struct FuzzOp {
+    enum class Kind : uint8_t {
+        Link,
+        Cut,
+        Isolate,
+        Query,
+    };
+
+    Kind kind;
+    int u;
+    int v;
+
+    operator std::string() const {
+        static const char* names[] = {"link", "cut", "isolate", "query"};
+        return std::string(names[static_cast<int>(kind)]) + " " +
+            std::to_string(u) + " " + std::to_string(v);
+    }
+};
+
+//  the trace is generated in phases of one kind, so the oracle is rebuilt
+//  once per phase change and not once per operation
+std::vector<FuzzOp> GenerateFuzzTrace(int vertex_count, size_t length, uint32_t seed) {
+    std::vector<FuzzOp> trace;
+    trace.reserve(length);
+    ReferenceForest oracle{vertex_count};
+    std::mt19937 rng{seed};
+
+    size_t max_phase = std::max<size_t>(1, length / 64);
+    while (trace.size() < length) {
+        auto kind = rng() % 20;
+        size_t phase = std::min(length - trace.size(), 1 + rng() % max_phase);
+        for (size_t step = 0; step < phase; ++step) {
+            int u = rng() % vertex_count;
+            int v = rng() % vertex_count;
+            if (kind < 8) {
+                if (u != v && !oracle.IsConnected(u, v)) {
+                    oracle.AddEdge(u, v);
+                    trace.push_back({FuzzOp::Kind::Link, u, v});
+                }
+            } else if (kind < 13) {
+                if (oracle.EdgesNumber()) {
+                    auto [from, to] = oracle.RandomEdge(rng);
+                    oracle.RemoveEdge(from, to);
+                    trace.push_back({FuzzOp::Kind::Cut, from, to});
+                }
+            } else if (kind < 14) {
+                oracle.IsolateVertex(u);
+                trace.push_back({FuzzOp::Kind::Isolate, u, u});
+                break;
+            } else {
+                if (rng() % 2) {
+                    for (int hops = rng() % 8; hops > 0; --hops) {
+                        v = oracle.RandomNeighbour(v, rng);
+                    }
+                    u = oracle.RandomNeighbour(v, rng);
+                }
+                trace.push_back({FuzzOp::Kind::Query, u, v});
+            }
+        }
+    }
+    return trace;
+}
+
+//  replays the trace against a fresh forest and oracle, skipping operations that
+//  are not valid any more (a shrunk trace may link connected vertices or cut a missing edge);
+//  returns the index of the first operation whose answer differs
+std::optional<size_t> ReplayFuzzTrace(int vertex_count, const std::vector<FuzzOp>& trace) {
+    DynamicForest forest{vertex_count};
+    ReferenceForest oracle{vertex_count};
+
+    std::vector<std::pair<int, int>> queries;
+    std::unique_ptr<bool[]> answers;
+    size_t answers_size = 0;
+
+    for (size_t begin = 0, end = 0; begin < trace.size(); begin = end) {
+        auto [kind, u, v] = trace[begin];
+        end = begin + 1;
+        if (kind == FuzzOp::Kind::Link) {
+            if (u != v && !oracle.IsConnected(u, v)) {
+                forest.AddEdge(u, v);
+                oracle.AddEdge(u, v);
+            }
+        } else if (kind == FuzzOp::Kind::Cut) {
+            if (oracle.HasEdge(u, v)) {
+                forest.RemoveEdge(u, v);
+                oracle.RemoveEdge(u, v);
+            }
+        } else if (kind == FuzzOp::Kind::Isolate) {
+            forest.RemoveVertex(u);
+            oracle.IsolateVertex(u);
+            if (forest.AddVertex() != u) {
+                return begin;
+            }
+        } else {
+            while (end < trace.size() && trace[end].kind == FuzzOp::Kind::Query) {
+                ++end;
+            }
+            queries.clear();
+            for (size_t idx = begin; idx < end; ++idx) {
+                queries.emplace_back(trace[idx].u, trace[idx].v);
+            }
+            if (answers_size < queries.size()) {
+                answers_size = queries.size();
+                answers = std::make_unique<bool[]>(answers_size);
+            }
+            forest.IsConnectedBatch(queries, {answers.get(), queries.size()});
+
+            for (size_t idx = begin; idx < end; ++idx) {
+                bool expected = oracle.IsConnected(trace[idx].u, trace[idx].v);
+                if (forest.IsConnected(trace[idx].u, trace[idx].v) != expected ||
+                    answers[idx - begin] != expected) {
+                    return idx;
+                }
+            }
+            if (forest.GetComponentsNumber() != oracle.GetComponentsNumber()) {
+                return end - 1;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+//  delta debugging: drops ever smaller chunks of operations while the replay still fails
+std::vector<FuzzOp> ShrinkFuzzTrace(int vertex_count, std::vector<FuzzOp> trace) {
+    auto failure = ReplayFuzzTrace(vertex_count, trace);
+    if (!failure) {
+        return trace;
+    }
+    trace.resize(*failure + 1);
+
+    std::vector<FuzzOp> candidate;
+    for (size_t chunk = trace.size() / 2; chunk > 0; chunk /= 2) {
+        for (size_t begin = 0; begin < trace.size();) {
+            candidate.assign(trace.begin(), trace.begin() + begin);
+            candidate.insert(candidate.end(),
+                             trace.begin() + std::min(trace.size(), begin + chunk), trace.end());
+            failure = ReplayFuzzTrace(vertex_count, candidate);
+            if (failure) {
+                candidate.resize(*failure + 1);
+                trace.swap(candidate);
+            } else {
+                begin += chunk;
+            }
+        }
+    }
+    return trace;
+}
+
+bool RunFuzz(int vertex_count, size_t length, uint32_t seed) {
+    auto trace = GenerateFuzzTrace(vertex_count, length, seed);
+    auto failure = ReplayFuzzTrace(vertex_count, trace);
+    if (!failure) {
+        return true;
+    }
+
+    std::cout << "FUZZ: mismatch at operation " << *failure << ", seed " << seed << std::endl;
+    trace = ShrinkFuzzTrace(vertex_count, std::move(trace));
+    std::cout << "FUZZ: shrunk to " << trace.size() << " operations" << std::endl;
+    for (const auto& op : trace) {
+        std::cout << std::string(op) << '\n';
+    }
+    std::cout.flush();
+    return false;
+}
+
+#endif //DYNAMIC_FOREST_FUZZ_H
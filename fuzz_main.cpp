@@ -0,0 +1,27 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "fuzz.h"
+
+
+//  usage: dynamic_forest_fuzz [vertex_count] [operations] [seed] [rounds]
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+
+    int vertex_count = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+    size_t length = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2'000'000;
+    uint32_t seed = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1337;
+    int rounds = argc > 4 ? std::atoi(argv[4]) : 1;
+
+    for (int round = 0; round < rounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        if (!RunFuzz(vertex_count, length, seed + round)) {
+            return 1;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "FUZZ " << vertex_count << " vertices, " << length << " operations, seed "
+                  << seed + round << ": SUCCESS (" << elapsed.count() << "s)" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,265 @@
+#ifndef DYNAMIC_FOREST_INDEX_TREAP_H
+#define DYNAMIC_FOREST_INDEX_TREAP_H
+
+#include <cassert>
+#include <cinttypes>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+//  Euler-tour treaps whose nodes live in one array and link each other by index, index 0 being
+//  a null node of size 0, and the open-addressing edge table next to them. CompactForest and
+//  SharedForest own the arrays; the classes here are views over them.
+namespace index_treap {
+    //  how the words of the nodes are written: plainly, or one relaxed atomic word at a time
+    //  when readers elsewhere load them in the middle of an update
+    struct PlainStore {
+        template<typename Word>
+        static void Store(Word& field, Word value) {
+            field = value;
+        }
+    };
+
+    struct RelaxedStore {
+        template<typename Word>
+        static void Store(Word& field, Word value) {
+            __atomic_store_n(&field, value, __ATOMIC_RELAXED);
+        }
+    };
+
+    template<typename Index>
+    struct Node {
+        Index left_son;
+        Index right_son;
+        Index ancestor;
+        Index size_of_treap;
+        uint32_t treap_priority;
+    };
+
+    template<typename Index>
+    Index GetTreapRoot(const Node<Index>* nodes, Index vertex) {
+        while (auto ancestor = nodes[vertex].ancestor) {
+            vertex = ancestor;
+        }
+        return vertex;
+    }
+
+    template<typename Index, typename Store = PlainStore>
+    class Treap {
+    public:
+        explicit Treap(Node<Index>* nodes) : nodes_{nodes} {
+        }
+
+        void Create(Index arc, uint32_t priority) {
+            auto& node = nodes_[arc];
+            Store::Store(node.left_son, Index{0});
+            Store::Store(node.right_son, Index{0});
+            Store::Store(node.ancestor, Index{0});
+            Store::Store(node.size_of_treap, Index{1});
+            Store::Store(node.treap_priority, priority);
+        }
+
+        Index GetTreapRoot(Index vertex) const {
+            return index_treap::GetTreapRoot(nodes_, vertex);
+        }
+
+        //  the tour of u from u_vertex on, edge_forward, the tour of v from v_vertex on,
+        //  edge_backward; 0 stands for a lone vertex without a tour
+        void Link(Index u_vertex, Index v_vertex, Index edge_forward, Index edge_backward) {
+            auto u_subtree = MoveToFirstPos(u_vertex);
+            auto v_subtree = MoveToFirstPos(v_vertex);
+            auto augmented_v_tree = MergeTreap(edge_forward, v_subtree);
+            augmented_v_tree = MergeTreap(augmented_v_tree, edge_backward);
+            MergeTreap(u_subtree, augmented_v_tree);
+        }
+
+        //  the arcs between the twins are the tour of one side, the arcs around them the other
+        void Cut(Index edge_one, Index edge_two) {
+            auto [root, pos_one, pos_two] = RootAndPositions(edge_one, edge_two);
+            if (pos_one > pos_two) {
+                std::swap(edge_one, edge_two);
+                std::swap(pos_one, pos_two);
+            }
+            auto [mid, right] = SplitTreap(root, pos_two);
+            [[maybe_unused]] auto [edge_bb, new_right] = SplitTreap(right, 1);
+            auto [left, new_subtree] = SplitTreap(mid, pos_one);
+            [[maybe_unused]] auto [edge_ff, inner] = SplitTreap(new_subtree, 1);
+
+            assert(edge_bb == edge_two);
+            assert(edge_one == edge_ff);
+
+            MergeTreap(left, new_right);
+        }
+
+        //  as treap::RepresentativeAfterCut: the arc following (x, y) in the cyclic tour
+        //  leaves y, so the arc after the twin takes over; called before the cut
+        Index RepresentativeAfterCut(Index representative, Index cut_arc, Index twin) const {
+            if (representative != cut_arc) {
+                return representative;
+            }
+            auto next = CyclicNext(twin);
+            return next == cut_arc ? 0 : next;
+        }
+
+    private:
+        void Update(Index vertex) {
+            auto& node = nodes_[vertex];
+            Store::Store(node.size_of_treap, static_cast<Index>(
+                1 + nodes_[node.left_son].size_of_treap + nodes_[node.right_son].size_of_treap));
+            Store::Store(node.ancestor, Index{0});
+            //  the null node's ancestor is never read, so the sons are relinked without branches
+            Store::Store(nodes_[node.left_son].ancestor, vertex);
+            Store::Store(nodes_[node.right_son].ancestor, vertex);
+        }
+
+        Index PosNumberInTreap(Index vertex) const {
+            Index pos = nodes_[nodes_[vertex].left_son].size_of_treap;
+            while (auto ancestor = nodes_[vertex].ancestor) {
+                if (nodes_[ancestor].right_son == vertex) {
+                    pos += nodes_[nodes_[ancestor].left_son].size_of_treap + 1;
+                }
+                vertex = ancestor;
+            }
+            return pos;
+        }
+
+        //  both walks of a cut in one loop, as treap::RootAndPositions
+        std::tuple<Index, Index, Index> RootAndPositions(Index one, Index two) const {
+            Index pos_one = nodes_[nodes_[one].left_son].size_of_treap;
+            Index pos_two = nodes_[nodes_[two].left_son].size_of_treap;
+            auto step = [this](Index& vertex, Index& pos) {
+                auto ancestor = nodes_[vertex].ancestor;
+                if (!ancestor) {
+                    return false;
+                }
+                if (nodes_[ancestor].right_son == vertex) {
+                    pos += nodes_[nodes_[ancestor].left_son].size_of_treap + 1;
+                }
+                vertex = ancestor;
+                return true;
+            };
+            while (step(one, pos_one) | step(two, pos_two)) {
+            }
+            return {one, pos_one, pos_two};
+        }
+
+        Index CyclicNext(Index vertex) const {
+            if (auto right = nodes_[vertex].right_son) {
+                while (nodes_[right].left_son) {
+                    right = nodes_[right].left_son;
+                }
+                return right;
+            }
+            while (auto ancestor = nodes_[vertex].ancestor) {
+                if (nodes_[ancestor].left_son == vertex) {
+                    return ancestor;
+                }
+                vertex = ancestor;
+            }
+            while (nodes_[vertex].left_son) {
+                vertex = nodes_[vertex].left_son;
+            }
+            return vertex;
+        }
+
+        std::pair<Index, Index> SplitTreap(Index vertex, uint32_t pivot) {
+            if (!vertex) {
+                return {0, 0};
+            }
+            auto& node = nodes_[vertex];
+            uint32_t left_size = nodes_[node.left_son].size_of_treap;
+            if (left_size >= pivot) {
+                auto [left, right] = SplitTreap(node.left_son, pivot);
+                Store::Store(node.left_son, right);
+                Update(vertex);
+                return {left, vertex};
+            } else {
+                auto [left, right] = SplitTreap(node.right_son, pivot - left_size - 1);
+                Store::Store(node.right_son, left);
+                Update(vertex);
+                return {vertex, right};
+            }
+        }
+
+        Index MergeTreap(Index left, Index right) {
+            if (!left) {
+                return right;
+            }
+            if (!right) {
+                return left;
+            }
+            if (nodes_[left].treap_priority > nodes_[right].treap_priority) {
+                Store::Store(nodes_[left].right_son, MergeTreap(nodes_[left].right_son, right));
+                Update(left);
+                return left;
+            } else {
+                Store::Store(nodes_[right].left_son, MergeTreap(left, nodes_[right].left_son));
+                Update(right);
+                return right;
+            }
+        }
+
+        Index MoveToFirstPos(Index vertex) {
+            if (!vertex) {
+                return 0;
+            }
+            auto pos = PosNumberInTreap(vertex);
+            auto root = GetTreapRoot(vertex);
+            auto [left, right] = SplitTreap(root, pos);
+            return MergeTreap(right, left);
+        }
+
+        Node<Index>* nodes_;
+    };
+
+    template<typename Key, typename Index>
+    struct TableEntry {
+        Key key;
+        Index arc;
+    };
+
+    //  arc 0 marks an empty slot; linear probing with backward shift deletion, so no
+    //  tombstones pile up. The size is a power of two
+    template<typename Key, typename Index>
+    class EdgeTable {
+    public:
+        EdgeTable(TableEntry<Key, Index>* entries, size_t size) : entries_{entries}, mask_{size - 1} {
+        }
+
+        void Insert(Key key, Index arc) {
+            auto slot = Slot(key);
+            while (entries_[slot].arc) {
+                slot = (slot + 1) & mask_;
+            }
+            entries_[slot] = {key, arc};
+        }
+
+        Index Erase(Key key) {
+            auto slot = Slot(key);
+            while (entries_[slot].key != key || !entries_[slot].arc) {
+                slot = (slot + 1) & mask_;
+            }
+            Index arc = entries_[slot].arc;
+            auto hole = slot;
+            for (auto next = (slot + 1) & mask_; entries_[next].arc; next = (next + 1) & mask_) {
+                auto home = Slot(entries_[next].key);
+                if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+                    entries_[hole] = entries_[next];
+                    hole = next;
+                }
+            }
+            entries_[hole] = {};
+            return arc;
+        }
+
+    private:
+        size_t Slot(Key key) const {
+            return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+        }
+
+        TableEntry<Key, Index>* entries_;
+        size_t mask_;
+    };
+}
+
+#endif //DYNAMIC_FOREST_INDEX_TREAP_H
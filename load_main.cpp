@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <unistd.h>
+#include "query_server.h"
+
+
+//  usage: dynamic_forest_load [vertex_count] [clients] [depth] [requests] [update_percent] [socket]
+//  every client keeps depth requests in flight and measures each one from send to answer;
+//  rejected requests are counted per op and left out of the latencies.
+//  Without a socket path the load generator serves a random forest itself
+int main(int argc, char** argv) {
+    std::ios_base::sync_with_stdio(false);
+
+    int vertex_count = argc > 1 ? std::atoi(argv[1]) : 1'000'000;
+    int clients = argc > 2 ? std::atoi(argv[2]) : 4;
+    size_t depth = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    size_t requests = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1'000'000;
+    uint32_t update_percent = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 1;
+    std::string path = argc > 6 ? argv[6] : "";
+
+    std::unique_ptr<DynamicForest> forest;
+    std::unique_ptr<QueryServer> server;
+    std::thread serving;
+    if (path.empty()) {
+        path = "/tmp/dynamic_forest_load_" + std::to_string(getpid()) + ".sock";
+        std::mt19937 rng{1337};
+        std::vector<std::pair<int, int>> edges;
+        for (int v_num = 1; v_num < vertex_count; ++v_num) {
+            if (rng() % 8) {
+                edges.emplace_back(rng() % v_num, v_num);
+            }
+        }
+        forest = std::make_unique<DynamicForest>(DynamicForest::Build(vertex_count, edges));
+        server = std::make_unique<QueryServer>(*forest, path);
+        serving = std::thread([&server] {
+            server->Run();
+        });
+    }
+
+    using Clock = std::chrono::steady_clock;
+    //  per client: latencies of answered requests, and per op how many were sent and rejected
+    struct OpCount {
+        size_t sent;
+        size_t rejected;
+    };
+    std::vector<std::vector<uint32_t>> latencies(clients);
+    std::vector<std::array<OpCount, 3>> counts(clients);
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (int client = 0; client < clients; ++client) {
+        workers.emplace_back([&, client] {
+            QueryClient connection{path};
+            std::mt19937 rng(client + 1);
+            struct InFlight {
+                Clock::time_point sent;
+                QueryOp op;
+                int u_num;
+                int v_num;
+            };
+            std::deque<InFlight> in_flight;
+            std::vector<QueryAnswer> answers(depth);
+            auto& latency = latencies[client];
+            auto& count = counts[client];
+            latency.reserve(requests);
+            //  a client cuts only the edges it linked itself and saw accepted,
+            //  so every cut hits an edge that is there
+            std::vector<std::pair<int, int>> linked;
+
+            size_t sent = 0;
+            size_t answered = 0;
+            while (answered < requests) {
+                auto now = Clock::now();
+                for (; sent < requests && in_flight.size() < depth; ++sent) {
+                    auto op = QueryOp::Connected;
+                    if (rng() % 100 < update_percent) {
+                        op = rng() % 2 || linked.empty() ? QueryOp::Link : QueryOp::Cut;
+                    }
+                    int u_num = rng() % vertex_count;
+                    int v_num = rng() % vertex_count;
+                    if (op == QueryOp::Cut) {
+                        auto idx = rng() % linked.size();
+                        std::tie(u_num, v_num) = linked[idx];
+                        linked[idx] = linked.back();
+                        linked.pop_back();
+                    }
+                    connection.Send(op, u_num, v_num);
+                    in_flight.push_back({now, op, u_num, v_num});
+                    ++count[static_cast<size_t>(op)].sent;
+                }
+                connection.Flush();
+                size_t received = connection.Receive(answers);
+                now = Clock::now();
+                for (size_t idx = 0; idx < received; ++idx) {
+                    auto request = in_flight.front();
+                    in_flight.pop_front();
+                    ++answered;
+                    if (answers[idx] == QueryAnswer::Rejected) {
+                        ++count[static_cast<size_t>(request.op)].rejected;
+                        continue;
+                    }
+                    if (request.op == QueryOp::Link) {
+                        linked.emplace_back(request.u_num, request.v_num);
+                    }
+                    latency.push_back(static_cast<uint32_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(now - request.sent).count()));
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    std::vector<uint32_t> all;
+    std::array<OpCount, 3> total{};
+    for (int client = 0; client < clients; ++client) {
+        all.insert(all.end(), latencies[client].begin(), latencies[client].end());
+        for (size_t op = 0; op < total.size(); ++op) {
+            total[op].sent += counts[client][op].sent;
+            total[op].rejected += counts[client][op].rejected;
+        }
+    }
+    size_t answered = total[0].sent + total[1].sent + total[2].sent;
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double share) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(share * all.size()))] / 1000.0;
+    };
+    auto op_line = [&total](QueryOp op) {
+        const auto& count = total[static_cast<size_t>(op)];
+        return std::to_string(count.sent) + " (" + std::to_string(count.rejected) + " rejected)";
+    };
+    std::cout << "LOAD " << clients << " clients, depth " << depth << ", " << answered << " requests in "
+              << elapsed.count() << "s: " << answered / elapsed.count() << " req/s" << std::endl;
+    std::cout << "  connected " << op_line(QueryOp::Connected) << ", link " << op_line(QueryOp::Link)
+              << ", cut " << op_line(QueryOp::Cut) << std::endl;
+    std::cout << "  accepted requests: p50 " << percentile(0.5) << "us, p99 " << percentile(0.99)
+              << "us, p99.9 " << percentile(0.999) << "us" << std::endl;
+
+    if (server) {
+        server->Stop();
+        serving.join();
+    }
+    return 0;
+}
@@ -13,6 +13,22 @@ int main() {
     TestSimple();
     TestSmall();
     TestMedium();
+    TestGrowable();
+    TestConnectedBatch();
+    TestPersistent();
+    TestTransactions();
+    TestComponentEvents();
+    TestExpiry();
+    TestCompact();
+    TestComponentIteration();
+    TestComponentSelection();
+    TestEdgeListLoader();
+    TestQueryServer();
+    TestConcurrent();
+    TestDynamicGraph();
+    TestBipartite();
+    TestWeighted();
+    TestSharedForest();
     TestLarge();
 
     return 0;
@@ -0,0 +1,376 @@
+#ifndef DYNAMIC_FOREST_QUERY_SERVER_H
+#define DYNAMIC_FOREST_QUERY_SERVER_H
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "euler_tour_tree.h"
+
+//  wire format: a request is the op byte followed by u and v as little-endian uint32,
+//  the answer is one byte; answers come back in request order on every connection,
+//  so a client may keep any number of requests in flight
+enum class QueryOp : uint8_t {
+    Connected,
+    Link,
+    Cut,
+};
+
+enum class QueryAnswer : uint8_t {
+    No,
+    Yes,
+    Rejected,  //  unknown op, vertex out of range, link inside a tree or cut of a missing edge
+};
+
+namespace query_protocol {
+    inline constexpr size_t kRequestSize = 9;
+
+    inline void EncodeRequest(char* out, QueryOp op, int u_num, int v_num) {
+        uint32_t ends[2] = {static_cast<uint32_t>(u_num), static_cast<uint32_t>(v_num)};
+        out[0] = static_cast<char>(op);
+        std::memcpy(out + 1, ends, sizeof(ends));
+    }
+
+    inline std::pair<int, sockaddr_un> SocketAddress(const std::string& path, int flags = 0) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("socket path is too long: " + path);
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | flags, 0);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("cannot create socket: ") + std::strerror(errno));
+        }
+        return {fd, address};
+    }
+}
+
+
+//  single threaded epoll loop over one forest: every wakeup parses all complete requests
+//  of all ready connections, connectivity queries are collected and answered by one
+//  IsConnectedBatch call, and an update first flushes the queries queued before it
+class QueryServer {
+public:
+    QueryServer(DynamicForest& forest, const std::string& path)
+        : forest_{forest}, path_{path} {
+        auto [fd, address] = query_protocol::SocketAddress(path, SOCK_NONBLOCK);
+        listen_fd_ = fd;
+        unlink(path.c_str());
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listen_fd_, SOMAXCONN) != 0) {
+            int error = errno;
+            close(listen_fd_);
+            throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(error));
+        }
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        Watch(listen_fd_, EPOLLIN, EPOLL_CTL_ADD);
+        Watch(stop_fd_, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    ~QueryServer() {
+        for (auto& connection : connections_) {
+            if (connection) {
+                close(connection->fd);
+            }
+        }
+        close(stop_fd_);
+        close(epoll_fd_);
+        close(listen_fd_);
+        unlink(path_.c_str());
+    }
+
+    //  serves until Stop is called
+    void Run() {
+        std::vector<epoll_event> events(kMaxEvents);
+        while (true) {
+            int ready = epoll_wait(epoll_fd_, events.data(), kMaxEvents, -1);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("epoll_wait: ") + std::strerror(errno));
+            }
+            for (int idx = 0; idx < ready; ++idx) {
+                int fd = events[idx].data.fd;
+                if (fd == stop_fd_) {
+                    return;
+                }
+                if (fd == listen_fd_) {
+                    Accept();
+                    continue;
+                }
+                auto& connection = *connections_[fd];
+                if (events[idx].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP)) {
+                    Read(connection);
+                }
+                if (!connection.active) {
+                    connection.active = true;
+                    active_.push_back(&connection);
+                }
+            }
+            FlushQueries();
+            for (auto connection : active_) {
+                connection->active = false;
+                Write(*connection);
+            }
+            active_.clear();
+        }
+    }
+
+    //  may be called from any thread
+    void Stop() {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = write(stop_fd_, &one, sizeof(one));
+    }
+
+private:
+    struct Connection {
+        int fd;
+        std::vector<char> input{};
+        std::vector<QueryAnswer> output{};
+        size_t output_begin{};
+        uint32_t interest{};
+        bool active{false};
+        bool closed{false};
+    };
+
+    static constexpr int kMaxEvents = 256;
+    static constexpr size_t kReadChunk = 64 * 1024;
+    //  a client that does not read its answers stops being read from
+    static constexpr size_t kMaxBacklog = 1 << 20;
+
+    void Watch(int fd, uint32_t events, int operation) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, operation, fd, &event) != 0) {
+            throw std::runtime_error(std::string("epoll_ctl: ") + std::strerror(errno));
+        }
+    }
+
+    void Accept() {
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            if (connections_.size() <= static_cast<size_t>(fd)) {
+                connections_.resize(fd + 1);
+            }
+            connections_[fd] = std::make_unique<Connection>(Connection{fd});
+            connections_[fd]->interest = EPOLLIN | EPOLLRDHUP;
+            Watch(fd, connections_[fd]->interest, EPOLL_CTL_ADD);
+        }
+    }
+
+    void Read(Connection& connection) {
+        auto& input = connection.input;
+        while (!connection.closed) {
+            size_t used = input.size();
+            input.resize(used + kReadChunk);
+            auto received = read(connection.fd, input.data() + used, kReadChunk);
+            input.resize(used + std::max<ssize_t>(received, 0));
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+                connection.closed = true;
+            } else if (received < 0) {
+                break;
+            }
+        }
+
+        size_t begin = 0;
+        for (; begin + query_protocol::kRequestSize <= input.size(); begin += query_protocol::kRequestSize) {
+            uint32_t ends[2];
+            std::memcpy(ends, input.data() + begin + 1, sizeof(ends));
+            Handle(connection, static_cast<QueryOp>(input[begin]), ends[0], ends[1]);
+        }
+        input.erase(input.begin(), input.begin() + begin);
+    }
+
+    void Handle(Connection& connection, QueryOp op, uint32_t u_ref, uint32_t v_ref) {
+        auto bound = static_cast<uint32_t>(forest_.VertexIdBound());
+        if (u_ref >= bound || v_ref >= bound || op > QueryOp::Cut) {
+            connection.output.push_back(QueryAnswer::Rejected);
+            return;
+        }
+        int u_num = static_cast<int>(u_ref);
+        int v_num = static_cast<int>(v_ref);
+        if (op == QueryOp::Connected) {
+            pending_.push_back({&connection, connection.output.size()});
+            queries_.emplace_back(u_num, v_num);
+            connection.output.push_back(QueryAnswer::No);
+            return;
+        }
+
+        FlushQueries();
+        bool valid = op == QueryOp::Link ? u_num != v_num && !forest_.IsConnected(u_num, v_num)
+                                         : forest_.HasEdge(u_num, v_num);
+        if (valid && op == QueryOp::Link) {
+            forest_.AddEdge(u_num, v_num);
+        } else if (valid) {
+            forest_.RemoveEdge(u_num, v_num);
+        }
+        connection.output.push_back(valid ? QueryAnswer::Yes : QueryAnswer::Rejected);
+    }
+
+    void FlushQueries() {
+        if (queries_.empty()) {
+            return;
+        }
+        if (answers_size_ < queries_.size()) {
+            answers_size_ = 2 * queries_.size();
+            answers_ = std::make_unique<bool[]>(answers_size_);
+        }
+        forest_.IsConnectedBatch(queries_, {answers_.get(), queries_.size()});
+        for (size_t idx = 0; idx < pending_.size(); ++idx) {
+            auto [connection, slot] = pending_[idx];
+            connection->output[slot] = answers_[idx] ? QueryAnswer::Yes : QueryAnswer::No;
+        }
+        queries_.clear();
+        pending_.clear();
+    }
+
+    void Write(Connection& connection) {
+        auto& output = connection.output;
+        while (connection.output_begin < output.size()) {
+            auto sent = send(connection.fd, output.data() + connection.output_begin,
+                             output.size() - connection.output_begin, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN) {
+                    connection.closed = true;
+                    connection.output_begin = output.size();
+                }
+                break;
+            }
+            connection.output_begin += sent;
+        }
+        if (connection.output_begin == output.size()) {
+            output.clear();
+            connection.output_begin = 0;
+        } else if (connection.output_begin > output.size() / 2) {
+            output.erase(output.begin(), output.begin() + connection.output_begin);
+            connection.output_begin = 0;
+        }
+
+        if (connection.closed && output.empty()) {
+            int fd = connection.fd;
+            close(fd);
+            connections_[fd].reset();
+            return;
+        }
+        uint32_t interest = 0;
+        if (!connection.closed && output.size() < kMaxBacklog) {
+            interest |= EPOLLIN | EPOLLRDHUP;
+        }
+        if (!output.empty()) {
+            interest |= EPOLLOUT;
+        }
+        if (interest != connection.interest) {
+            connection.interest = interest;
+            Watch(connection.fd, interest, EPOLL_CTL_MOD);
+        }
+    }
+
+    DynamicForest& forest_;
+    std::string path_;
+    int listen_fd_{-1};
+    int epoll_fd_{-1};
+    int stop_fd_{-1};
+    std::vector<std::unique_ptr<Connection>> connections_{};
+    std::vector<Connection*> active_{};
+
+    std::vector<std::pair<int, int>> queries_{};
+    std::vector<std::pair<Connection*, size_t>> pending_{};
+    std::unique_ptr<bool[]> answers_{};
+    size_t answers_size_{};
+};
+
+
+//  blocking client: Send only buffers, so a caller pipelines by sending a run of
+//  requests, calling Flush and then collecting the answers
+class QueryClient {
+public:
+    explicit QueryClient(const std::string& path) {
+        auto [fd, address] = query_protocol::SocketAddress(path);
+        fd_ = fd;
+        if (connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            int error = errno;
+            close(fd_);
+            throw std::runtime_error("cannot connect to " + path + ": " + std::strerror(error));
+        }
+    }
+
+    QueryClient(const QueryClient&) = delete;
+    QueryClient& operator=(const QueryClient&) = delete;
+
+    ~QueryClient() {
+        close(fd_);
+    }
+
+    void Send(QueryOp op, int u_num, int v_num) {
+        size_t used = output_.size();
+        output_.resize(used + query_protocol::kRequestSize);
+        query_protocol::EncodeRequest(output_.data() + used, op, u_num, v_num);
+    }
+
+    void Flush() {
+        for (size_t begin = 0; begin < output_.size();) {
+            auto sent = send(fd_, output_.data() + begin, output_.size() - begin, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("send: ") + std::strerror(errno));
+            }
+            begin += sent;
+        }
+        output_.clear();
+    }
+
+    //  blocks until at least one answer arrives, returns how many were stored
+    size_t Receive(std::span<QueryAnswer> out) {
+        while (true) {
+            auto received = recv(fd_, out.data(), out.size(), 0);
+            if (received > 0) {
+                return static_cast<size_t>(received);
+            }
+            if (received == 0) {
+                throw std::runtime_error("server closed the connection");
+            }
+            if (errno != EINTR) {
+                throw std::runtime_error(std::string("recv: ") + std::strerror(errno));
+            }
+        }
+    }
+
+    QueryAnswer Receive() {
+        QueryAnswer answer;
+        Receive({&answer, 1});
+        return answer;
+    }
+
+private:
+    int fd_{-1};
+    std::vector<char> output_{};
+};
+
+#endif //DYNAMIC_FOREST_QUERY_SERVER_H
@@ -0,0 +1,128 @@
+#ifndef DYNAMIC_FOREST_REFERENCE_FOREST_H
+#define DYNAMIC_FOREST_REFERENCE_FOREST_H
+
+#include <algorithm>
+#include <cinttypes>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//  oracle for large randomized checks: links are united into a disjoint set union
+//  on the fly, cuts only mark it dirty and it is rebuilt from the edge list
+//  before the next connectivity question, so a run of queries costs O(n + m) once
+class ReferenceForest {
+public:
+    explicit ReferenceForest(int vertex_count)
+        : size_{vertex_count}, adjacency_(vertex_count), parent_(vertex_count) {
+        std::iota(parent_.begin(), parent_.end(), 0);
+    }
+
+    int Size() const {
+        return size_;
+    }
+
+    int GetComponentsNumber() const {
+        return size_ - static_cast<int>(edges_.size());
+    }
+
+    int EdgesNumber() const {
+        return static_cast<int>(edges_.size());
+    }
+
+    bool HasEdge(int u_num, int v_num) const {
+        return edge_index_.contains(EncodeEdge(u_num, v_num));
+    }
+
+    template<typename Rng>
+    std::pair<int, int> RandomEdge(Rng& rng) const {
+        return edges_[rng() % edges_.size()];
+    }
+
+    template<typename Rng>
+    int RandomNeighbour(int v_num, Rng& rng) const {
+        if (adjacency_[v_num].empty()) {
+            return v_num;
+        }
+        return adjacency_[v_num][rng() % adjacency_[v_num].size()];
+    }
+
+    void AddEdge(int u_num, int v_num) {
+        edge_index_[EncodeEdge(u_num, v_num)] = edges_.size();
+        edges_.emplace_back(u_num, v_num);
+        adjacency_[u_num].push_back(v_num);
+        adjacency_[v_num].push_back(u_num);
+        if (!dirty_) {
+            parent_[Find(u_num)] = Find(v_num);
+        }
+    }
+
+    void RemoveEdge(int u_num, int v_num) {
+        auto iter = edge_index_.find(EncodeEdge(u_num, v_num));
+        auto idx = iter->second;
+        edge_index_.erase(iter);
+        if (idx + 1 != edges_.size()) {
+            edges_[idx] = edges_.back();
+            edge_index_[EncodeEdge(edges_[idx].first, edges_[idx].second)] = idx;
+        }
+        edges_.pop_back();
+        EraseNeighbour(u_num, v_num);
+        EraseNeighbour(v_num, u_num);
+        dirty_ = true;
+    }
+
+    void IsolateVertex(int v_num) {
+        while (!adjacency_[v_num].empty()) {
+            RemoveEdge(v_num, adjacency_[v_num].back());
+        }
+    }
+
+    bool IsConnected(int u_num, int v_num) {
+        if (dirty_) {
+            Rebuild();
+        }
+        return Find(u_num) == Find(v_num);
+    }
+
+private:
+    static uint64_t EncodeEdge(int u_num, int v_num) {
+        if (u_num > v_num) {
+            std::swap(u_num, v_num);
+        }
+        return (static_cast<uint64_t>(static_cast<uint32_t>(u_num)) << 32) |
+            static_cast<uint32_t>(v_num);
+    }
+
+    void EraseNeighbour(int v_num, int u_num) {
+        auto& neighbours = adjacency_[v_num];
+        auto iter = std::find(neighbours.begin(), neighbours.end(), u_num);
+        *iter = neighbours.back();
+        neighbours.pop_back();
+    }
+
+    int Find(int v_num) {
+        while (parent_[v_num] != v_num) {
+            parent_[v_num] = parent_[parent_[v_num]];
+            v_num = parent_[v_num];
+        }
+        return v_num;
+    }
+
+    void Rebuild() {
+        std::iota(parent_.begin(), parent_.end(), 0);
+        for (auto [u_num, v_num] : edges_) {
+            parent_[Find(u_num)] = Find(v_num);
+        }
+        dirty_ = false;
+    }
+
+    int size_{};
+    std::vector<std::pair<int, int>> edges_{};
+    std::unordered_map<uint64_t, size_t> edge_index_{};
+    std::vector<std::vector<int>> adjacency_{};
+    std::vector<int> parent_{};
+    bool dirty_{false};
+};
+
+#endif //DYNAMIC_FOREST_REFERENCE_FOREST_H
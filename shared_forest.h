@@ -0,0 +1,336 @@
+#ifndef DYNAMIC_FOREST_SHARED_FOREST_H
+#define DYNAMIC_FOREST_SHARED_FOREST_H
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "index_treap.h"
+
+//  forest living in a named POSIX shared memory segment: the arcs, the representatives and the
+//  edge table are arrays inside the segment and refer to each other by index (0 is a null node
+//  of size 0, as in CompactForest), so every process can map the segment at its own address.
+//  One process creates the segment and is the only writer; any number of readers attach
+//  read-only and answer IsConnected from the mapping. The writer bumps a sequence number to
+//  odd before an update and back to even after it; a reader retries a query that saw an odd
+//  number or saw it change, so readers never block the writer and need no IPC per query.
+class SharedForest {
+public:
+    //  creates the segment and becomes its writer. An old segment of the same name is unlinked
+    //  first, never truncated: readers still mapping it keep reading it, not a zeroed file
+    static SharedForest Create(const std::string& name, int vertex_count, const uint32_t seed = 1337) {
+        SharedForest forest;
+        uint32_t max_arcs = 2 * static_cast<uint32_t>(std::max(vertex_count, 1) - 1);
+        uint64_t table_size = 2;
+        while (table_size < 2ull * max_arcs) {
+            table_size *= 2;
+        }
+        Layout layout{static_cast<uint32_t>(vertex_count), max_arcs, table_size};
+
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("cannot create " + name + ": " + std::strerror(errno));
+        }
+        if (ftruncate(fd, static_cast<off_t>(layout.Size())) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("cannot size " + name + ": " + std::strerror(error));
+        }
+        forest.Map(fd, layout.Size(), PROT_READ | PROT_WRITE, name);
+        forest.writer_ = true;
+
+        //  a fresh segment reads as zeros: no edges, no representatives, an empty table
+        auto header = forest.header_;
+        header->vertex_count = layout.vertex_count;
+        header->max_arcs = layout.max_arcs;
+        header->table_size = layout.table_size;
+        header->rng_state = seed | 1;
+        forest.Bind();
+        for (uint32_t idx = 0; idx < max_arcs; ++idx) {
+            forest.free_arcs_[idx] = max_arcs - idx;
+        }
+        header->free_count = max_arcs;
+        header->magic = kMagic;
+        return forest;
+    }
+
+    //  maps an existing segment read-only; the reader costs O(1) memory of its own
+    static SharedForest Attach(const std::string& name) {
+        SharedForest forest;
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open " + name + ": " + std::strerror(errno));
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error(name + " is not a shared forest");
+        }
+        forest.Map(fd, static_cast<size_t>(info.st_size), PROT_READ, name);
+        auto header = forest.header_;
+        Layout layout{header->vertex_count, header->max_arcs, header->table_size};
+        if (header->magic != kMagic || layout.Size() != forest.size_) {
+            throw std::runtime_error(name + " is not a shared forest");
+        }
+        forest.Bind();
+        return forest;
+    }
+
+    static void Remove(const std::string& name) {
+        shm_unlink(name.c_str());
+    }
+
+    SharedForest(SharedForest&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    SharedForest& operator=(SharedForest&& other) noexcept {
+        std::swap(memory_, other.memory_);
+        std::swap(size_, other.size_);
+        std::swap(writer_, other.writer_);
+        Bind();
+        other.Bind();
+        return *this;
+    }
+
+    ~SharedForest() {
+        if (memory_) {
+            munmap(memory_, size_);
+        }
+    }
+
+    //  the number of updates published so far
+    uint64_t Version() const {
+        return header_->sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    int GetComponentsNumber() const {
+        return Read([this] {
+            return static_cast<int>(header_->vertex_count) -
+                static_cast<int>(__atomic_load_n(&header_->edges_number, __ATOMIC_RELAXED));
+        });
+    }
+
+    bool IsConnected(int u_num, int v_num) const {
+        if (u_num == v_num) {
+            return true;
+        }
+        return Read([this, u_num, v_num] {
+            auto u_vertex = Load(representative_[u_num]);
+            auto v_vertex = Load(representative_[v_num]);
+            return u_vertex && v_vertex && ReaderRoot(u_vertex) == ReaderRoot(v_vertex);
+        });
+    }
+
+    void AddEdge(int u_num, int v_num) {
+        assert(writer_);
+        BeginUpdate();
+        uint32_t edge_forward = CreateArc();
+        uint32_t edge_backward = CreateArc();
+        Table().Insert(EncodeEdge(u_num, v_num), edge_forward);
+        Table().Insert(EncodeEdge(v_num, u_num), edge_backward);
+        Treap().Link(representative_[u_num], representative_[v_num], edge_forward, edge_backward);
+
+        if (!representative_[u_num]) {
+            Store(representative_[u_num], edge_forward);
+        }
+        if (!representative_[v_num]) {
+            Store(representative_[v_num], edge_backward);
+        }
+        Store(header_->edges_number, header_->edges_number + 1);
+        EndUpdate();
+    }
+
+    void RemoveEdge(int u_num, int v_num) {
+        assert(writer_);
+        BeginUpdate();
+        uint32_t edge_one = Table().Erase(EncodeEdge(u_num, v_num));
+        uint32_t edge_two = Table().Erase(EncodeEdge(v_num, u_num));
+        auto treap = Treap();
+        Store(representative_[u_num], treap.RepresentativeAfterCut(representative_[u_num], edge_one, edge_two));
+        Store(representative_[v_num], treap.RepresentativeAfterCut(representative_[v_num], edge_two, edge_one));
+        treap.Cut(edge_one, edge_two);
+        free_arcs_[header_->free_count++] = edge_one;
+        free_arcs_[header_->free_count++] = edge_two;
+        Store(header_->edges_number, header_->edges_number - 1);
+        EndUpdate();
+    }
+
+private:
+    using Node = index_treap::Node<uint32_t>;
+    using TableEntry = index_treap::TableEntry<uint64_t, uint32_t>;
+
+    struct alignas(64) Header {
+        uint64_t magic;
+        uint32_t vertex_count;
+        uint32_t max_arcs;
+        uint64_t table_size;
+        std::atomic<uint64_t> sequence;
+        uint32_t edges_number;
+        uint32_t free_count;
+        uint32_t rng_state;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    //  header, nodes, free arcs, representatives and the table, each on its own cache line
+    struct Layout {
+        uint32_t vertex_count;
+        uint32_t max_arcs;
+        uint64_t table_size;
+
+        static size_t Align(size_t offset) {
+            return (offset + 63) & ~size_t{63};
+        }
+
+        size_t Nodes() const {
+            return Align(sizeof(Header));
+        }
+
+        size_t FreeArcs() const {
+            return Align(Nodes() + (max_arcs + 1ull) * sizeof(Node));
+        }
+
+        size_t Representatives() const {
+            return Align(FreeArcs() + max_arcs * sizeof(uint32_t));
+        }
+
+        size_t Table() const {
+            return Align(Representatives() + vertex_count * sizeof(uint32_t));
+        }
+
+        size_t Size() const {
+            return Table() + table_size * sizeof(TableEntry);
+        }
+    };
+
+    static constexpr uint64_t kMagic = 0x7473657266726873ull;  //  "shrfrest"
+    //  a longer walk means the reader looked at a tree in the middle of an update
+    static constexpr size_t kMaxWalk = 1 << 12;
+
+    SharedForest() = default;
+
+    void Map(int fd, size_t size, int protection, const std::string& name) {
+        void* memory = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (memory == MAP_FAILED) {
+            throw std::runtime_error("cannot map " + name + ": " + std::strerror(error));
+        }
+        memory_ = memory;
+        size_ = size;
+        header_ = static_cast<Header*>(memory_);
+    }
+
+    void Bind() {
+        if (!memory_) {
+            header_ = nullptr;
+            nodes_ = nullptr;
+            free_arcs_ = representative_ = nullptr;
+            table_ = nullptr;
+            return;
+        }
+        auto base = static_cast<char*>(memory_);
+        header_ = reinterpret_cast<Header*>(base);
+        Layout layout{header_->vertex_count, header_->max_arcs, header_->table_size};
+        nodes_ = reinterpret_cast<Node*>(base + layout.Nodes());
+        free_arcs_ = reinterpret_cast<uint32_t*>(base + layout.FreeArcs());
+        representative_ = reinterpret_cast<uint32_t*>(base + layout.Representatives());
+        table_ = reinterpret_cast<TableEntry*>(base + layout.Table());
+    }
+
+    //  readers load the words the writer changes while they read, so the writer stores every
+    //  word of the nodes, the representatives and the edge count atomically as well; the
+    //  seqlock orders them, the atomics only keep each word whole
+    static uint32_t Load(const uint32_t& field) {
+        return __atomic_load_n(&field, __ATOMIC_RELAXED);
+    }
+
+    static void Store(uint32_t& field, uint32_t value) {
+        index_treap::RelaxedStore::Store(field, value);
+    }
+
+    template<typename Function>
+    auto Read(Function&& function) const -> decltype(function()) {
+        while (true) {
+            auto before = header_->sequence.load(std::memory_order_acquire);
+            if (before % 2 == 0) {
+                auto result = function();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header_->sequence.load(std::memory_order_relaxed) == before) {
+                    return result;
+                }
+            }
+        }
+    }
+
+    void BeginUpdate() {
+        header_->sequence.store(header_->sequence.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndUpdate() {
+        header_->sequence.store(header_->sequence.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_release);
+    }
+
+    static uint64_t EncodeEdge(int u_num, int v_num) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(u_num)) << 32) |
+            static_cast<uint32_t>(v_num);
+    }
+
+    //  the writer stores every node word atomically, readers walk the nodes meanwhile
+    index_treap::Treap<uint32_t, index_treap::RelaxedStore> Treap() {
+        return index_treap::Treap<uint32_t, index_treap::RelaxedStore>{nodes_};
+    }
+
+    index_treap::EdgeTable<uint64_t, uint32_t> Table() {
+        return {table_, header_->table_size};
+    }
+
+    uint32_t CreateArc() {
+        uint32_t arc = free_arcs_[--header_->free_count];
+        auto& state = header_->rng_state;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        Treap().Create(arc, state);
+        return arc;
+    }
+
+    //  a reader's walk; 0 when the walk does not end, which only happens when it races with
+    //  the writer and Read throws the answer away
+    uint32_t ReaderRoot(uint32_t vertex) const {
+        for (size_t step = 0; step < kMaxWalk; ++step) {
+            auto ancestor = Load(nodes_[vertex].ancestor);
+            if (!ancestor) {
+                return vertex;
+            }
+            vertex = ancestor;
+        }
+        return 0;
+    }
+
+    void* memory_{};
+    size_t size_{};
+    bool writer_{false};
+    Header* header_{};
+    Node* nodes_{};
+    uint32_t* free_arcs_{};
+    uint32_t* representative_{};
+    TableEntry* table_{};
+};
+
+#endif //DYNAMIC_FOREST_SHARED_FOREST_H
@@ -0,0 +1,74 @@
+#ifndef DYNAMIC_FOREST_SPSC_RING_H
+#define DYNAMIC_FOREST_SPSC_RING_H
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+//  bounded ring for one producer thread and one consumer thread, no locks: the producer owns
+//  tail_, the consumer owns head_, each reads the other's index with acquire. A full ring never
+//  blocks the producer, the value is dropped and counted so the consumer knows it has to resync.
+template<typename Value>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        values_.resize(size);
+        mask_ = size - 1;
+    }
+
+    size_t Capacity() const {
+        return values_.size();
+    }
+
+    //  producer side; false if the ring is full and the value was dropped
+    bool Push(const Value& value) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == values_.size()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == values_.size()) {
+                lost_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        values_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //  consumer side
+    std::optional<Value> Pop() {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return std::nullopt;
+            }
+        }
+        Value value = values_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    //  values dropped on a full ring so far
+    uint64_t Lost() const {
+        return lost_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<Value> values_;
+    size_t mask_{};
+
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    uint64_t cached_head_{0};
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t cached_tail_{0};
+    alignas(64) std::atomic<uint64_t> lost_{0};
+};
+
+#endif //DYNAMIC_FOREST_SPSC_RING_H
@@ -2,9 +2,25 @@
 #define DYNAMIC_FOREST_TEST_H
 
 #include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <list>
+#include <memory>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "simple_graph.h"
+#include "bipartite_graph.h"
+#include "compact_forest.h"
+#include "concurrent_forest.h"
+#include "dynamic_graph.h"
+#include "edge_list_loader.h"
 #include "euler_tour_tree.h"
+#include "query_server.h"
+#include "reference_forest.h"
+#include "shared_forest.h"
+#include "weighted_forest.h"
 
 void TestAddEdge() {
     {
@@ -186,6 +202,1274 @@ void TestMedium(const uint32_t random_seed = 998) {
     std::cout << "TEST MEDIUM: SUCCESS" << std::endl;
 }
 
+void TestGrowable(const uint32_t random_seed = 998) {
+    {
+        DynamicForest forest{0};
+        for (int v = 0; v < 5; ++v) {
+            [[maybe_unused]] int id = forest.AddVertex();
+            assert(id == v);
+        }
+        forest.AddEdge(0, 1);
+        forest.AddEdge(1, 2);
+        forest.AddEdge(1, 3);
+        forest.AddEdge(3, 4);
+        assert(forest.GetComponentsNumber() == 1);
+
+        forest.RemoveVertex(1);
+        assert(forest.GetComponentsNumber() == 3);
+        assert(forest.IsConnected(0, 2) == 0);
+        assert(forest.IsConnected(2, 3) == 0);
+        assert(forest.IsConnected(3, 4) == 1);
+
+        [[maybe_unused]] int id = forest.AddVertex();
+        assert(id == 1);
+        assert(forest.IsConnected(1, 0) == 0);
+        forest.AddEdge(1, 0);
+        forest.AddEdge(4, 1);
+        assert(forest.IsConnected(0, 3) == 1);
+        assert(forest.IsConnected(2, 3) == 0);
+        assert(forest.GetComponentsNumber() == 2);
+    }
+    {
+        int size = 150;
+        int queries_cnt = 600;
+        int count_checks = 100;
+
+        DynamicForest forest{0};
+        SimpleGraph graph{size};
+        std::vector<bool> alive(size, true);
+        for (int v = 0; v < size; ++v) {
+            forest.AddVertex();
+        }
+
+        std::mt19937 rng{random_seed};
+
+        for (int iter_num = 0; iter_num < queries_cnt; ++iter_num) {
+            auto kind = rng() % 8;
+            if (kind < 4) {
+                std::vector<std::pair<int, int>> pairs;
+                for (auto [u, v] : graph.ToPairs(false)) {
+                    if (alive[u] && alive[v]) {
+                        pairs.emplace_back(u, v);
+                    }
+                }
+                if (pairs.empty()) {
+                    continue;
+                }
+                auto [u, v] = pairs[rng() % pairs.size()];
+                graph.AddEdge(u, v);
+                forest.AddEdge(u, v);
+            } else if (kind < 6) {
+                auto pairs = graph.ToPairs(true);
+                if (pairs.empty()) {
+                    continue;
+                }
+                auto [u, v] = pairs[rng() % pairs.size()];
+                graph.RemoveEdge(u, v);
+                forest.RemoveEdge(u, v);
+            } else if (kind < 7) {
+                int v = rng() % size;
+                if (!alive[v]) {
+                    continue;
+                }
+                for (auto [from, to] : graph.ToPairs(true)) {
+                    if (from == v) {
+                        graph.RemoveEdge(from, to);
+                    }
+                }
+                forest.RemoveVertex(v);
+                alive[v] = false;
+            } else {
+                if (std::find(alive.begin(), alive.end(), false) == alive.end()) {
+                    continue;
+                }
+                int v = forest.AddVertex();
+                assert(!alive[v]);
+                alive[v] = true;
+            }
+            graph.CalculateConnectMatrix();
+
+            [[maybe_unused]] int alive_count = std::count(alive.begin(), alive.end(), true);
+            [[maybe_unused]] int edges_count = static_cast<int>(graph.ToPairs(true).size() / 2);
+            assert(forest.GetComponentsNumber() == alive_count - edges_count);
+
+            for (int check_iter = 0; check_iter < count_checks; ++check_iter) {
+                int u = rng() % size;
+                int v = rng() % size;
+                if (!alive[u] || !alive[v]) {
+                    continue;
+                }
+                if (graph.IsConnected(u, v) != forest.IsConnected(u, v)) {
+                    throw;
+                }
+            }
+        }
+    }
+
+    std::cout << "TEST GROWABLE: SUCCESS" << std::endl;
+}
+
+void TestConnectedBatch(const uint32_t random_seed = 998) {
+    int size = 20'000;
+    int queries_cnt = 10'000;
+
+    DynamicForest forest{size};
+    std::mt19937 rng{random_seed};
+    for (int v = 1; v < size; ++v) {
+        if (rng() % 4) {
+            forest.AddEdge(rng() % v, v);
+        }
+    }
+
+    std::vector<std::pair<int, int>> queries(queries_cnt);
+    for (auto& [u, v] : queries) {
+        u = rng() % size;
+        v = rng() % 16 ? rng() % size : u;
+    }
+    auto answers = std::make_unique<bool[]>(queries_cnt);
+    forest.IsConnectedBatch(queries, {answers.get(), queries.size()});
+
+    for (int idx = 0; idx < queries_cnt; ++idx) {
+        [[maybe_unused]] auto [u, v] = queries[idx];
+        assert(answers[idx] == forest.IsConnected(u, v));
+    }
+
+    std::cout << "TEST CONNECTED BATCH: SUCCESS" << std::endl;
+}
+
+void TestPersistent(const uint32_t random_seed = 998) {
+    int size = 120;
+    int queries_cnt = 400;
+    int count_checks = 2'000;
+
+    DynamicForest forest{size};
+    ReferenceForest oracle{size};
+    std::mt19937 rng{random_seed};
+
+    for (int v = 1; v < size / 2; ++v) {
+        int anc = rng() % v;
+        forest.AddEdge(anc, v);
+        oracle.AddEdge(anc, v);
+    }
+    forest.EnablePersistence();
+
+    std::vector<ReferenceForest> snapshots{oracle};
+    uint64_t first_version = forest.Version();
+
+    for (int iter_num = 0; iter_num < queries_cnt; ++iter_num) {
+        int u = rng() % size;
+        int v = rng() % size;
+        auto kind = rng() % 10;
+        if (kind < 5 && !oracle.IsConnected(u, v)) {
+            forest.AddEdge(u, v);
+            oracle.AddEdge(u, v);
+        } else if (kind < 9 && oracle.EdgesNumber()) {
+            auto [from, to] = oracle.RandomEdge(rng);
+            forest.RemoveEdge(from, to);
+            oracle.RemoveEdge(from, to);
+        } else {
+            forest.RemoveVertex(u);
+            oracle.IsolateVertex(u);
+            [[maybe_unused]] int id = forest.AddVertex();
+            assert(id == u);
+        }
+        snapshots.push_back(oracle);
+        assert(forest.Version() == first_version + snapshots.size() - 1);
+    }
+
+    auto check = [&](size_t oldest) {
+        for (int check_iter = 0; check_iter < count_checks; ++check_iter) {
+            size_t idx = oldest + rng() % (snapshots.size() - oldest);
+            int u = rng() % size;
+            int v = rng() % size;
+            if (snapshots[idx].IsConnected(u, v) != forest.IsConnectedAt(u, v, first_version + idx)) {
+                throw;
+            }
+        }
+    };
+    check(0);
+
+    size_t oldest = snapshots.size() / 2;
+    forest.ReleaseVersionsBefore(first_version + oldest);
+    assert(forest.OldestVersion() == first_version + oldest);
+    check(oldest);
+
+    for (int v = 0; v < size; ++v) {
+        assert(forest.IsConnectedAt(0, v, forest.Version()) == forest.IsConnected(0, v));
+    }
+
+    std::cout << "TEST PERSISTENT: SUCCESS" << std::endl;
+}
+
+void TestTransactions(const uint32_t random_seed = 998) {
+    int size = 150;
+    int transactions_cnt = 200;
+    int count_checks = 300;
+
+    DynamicForest forest{size};
+    ReferenceForest oracle{size};
+    std::mt19937 rng{random_seed};
+
+    for (int iter_num = 0; iter_num < transactions_cnt; ++iter_num) {
+        bool commit = rng() % 3 == 0;
+        ReferenceForest what_if = oracle;
+
+        forest.Begin();
+        for (int op_num = rng() % 20; op_num > 0; --op_num) {
+            int u = rng() % size;
+            int v = rng() % size;
+            auto kind = rng() % 10;
+            if (kind < 6 && !what_if.IsConnected(u, v)) {
+                forest.AddEdge(u, v);
+                what_if.AddEdge(u, v);
+            } else if (kind < 9 && what_if.EdgesNumber()) {
+                auto [from, to] = what_if.RandomEdge(rng);
+                forest.RemoveEdge(from, to);
+                what_if.RemoveEdge(from, to);
+            } else {
+                forest.RemoveVertex(u);
+                what_if.IsolateVertex(u);
+                [[maybe_unused]] int id = forest.AddVertex();
+                assert(id == u);
+            }
+        }
+        if (commit) {
+            forest.Commit();
+            oracle = what_if;
+        } else {
+            forest.Rollback();
+        }
+        assert(!forest.InTransaction());
+        assert(forest.GetComponentsNumber() == oracle.GetComponentsNumber());
+
+        for (int check_iter = 0; check_iter < count_checks; ++check_iter) {
+            int u = rng() % size;
+            int v = rng() % size;
+            if (oracle.IsConnected(u, v) != forest.IsConnected(u, v)) {
+                throw;
+            }
+        }
+    }
+
+    std::cout << "TEST TRANSACTIONS: SUCCESS" << std::endl;
+}
+
+void TestComponentEvents(const uint32_t random_seed = 998) {
+    int size = 2'000;
+    int transactions_cnt = 3'000;
+
+    DynamicForest forest{size};
+    ReferenceForest oracle{size};
+    std::mt19937 rng{random_seed};
+    ComponentEventRing events{1 << 12};
+    forest.Subscribe(&events);
+
+    //  the consumer rebuilds every component size from the events alone
+    std::atomic<bool> done{false};
+    std::unordered_map<uint64_t, uint32_t> sizes;
+    for (int v = 0; v < size; ++v) {
+        sizes[forest.ComponentId(v)] = 1;
+    }
+    std::thread consumer([&] {
+        while (true) {
+            bool finished = done.load(std::memory_order_acquire);
+            while (auto event = events.Pop()) {
+                if (event->kind == ComponentEvent::Kind::Merged) {
+                    if (sizes.at(event->survivor) + event->other_size != event->survivor_size ||
+                        sizes.at(event->other) != event->other_size) {
+                        throw;
+                    }
+                    sizes.erase(event->other);
+                } else {
+                    if (sizes.contains(event->other) || event->survivor_size < event->other_size ||
+                        sizes.at(event->survivor) != event->survivor_size + event->other_size) {
+                        throw;
+                    }
+                    sizes[event->other] = event->other_size;
+                }
+                sizes[event->survivor] = event->survivor_size;
+            }
+            if (finished) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    for (int iter_num = 0; iter_num < transactions_cnt; ++iter_num) {
+        bool transaction = rng() % 4 == 0;
+        bool commit = rng() % 2 == 0;
+        ReferenceForest what_if = oracle;
+        std::vector<uint64_t> ids;
+        if (transaction) {
+            for (int v = 0; v < size; v += 97) {
+                ids.push_back(forest.ComponentId(v));
+            }
+            forest.Begin();
+        }
+        for (int op_num = transaction ? rng() % 10 : 1; op_num > 0; --op_num) {
+            int u = rng() % size;
+            int v = rng() % size;
+            auto kind = rng() % 20;
+            if (kind < 12 && !what_if.IsConnected(u, v)) {
+                auto survivor = forest.ComponentSize(u) < forest.ComponentSize(v) ? v : u;
+                [[maybe_unused]] auto id = forest.ComponentId(survivor);
+                forest.AddEdge(u, v);
+                what_if.AddEdge(u, v);
+                assert(forest.ComponentId(v) == id && forest.ComponentId(u) == id);
+            } else if (kind < 19 && what_if.EdgesNumber()) {
+                auto [from, to] = what_if.RandomEdge(rng);
+                auto id = forest.ComponentId(from);
+                forest.RemoveEdge(from, to);
+                what_if.RemoveEdge(from, to);
+                [[maybe_unused]] bool from_kept = forest.ComponentId(from) == id;
+                [[maybe_unused]] bool to_kept = forest.ComponentId(to) == id;
+                assert(from_kept != to_kept);
+                assert(forest.ComponentSize(from_kept ? from : to) >= forest.ComponentSize(from_kept ? to : from));
+            } else {
+                forest.RemoveVertex(u);
+                what_if.IsolateVertex(u);
+                [[maybe_unused]] int id = forest.AddVertex();
+                assert(id == u);
+            }
+        }
+        if (!transaction || commit) {
+            if (transaction) {
+                forest.Commit();
+            }
+            oracle = what_if;
+        } else {
+            forest.Rollback();
+            for (int v = 0, idx = 0; v < size; v += 97, ++idx) {
+                assert(forest.ComponentId(v) == ids[idx]);
+            }
+        }
+    }
+    done.store(true, std::memory_order_release);
+    consumer.join();
+    assert(events.Lost() == 0);
+
+    for (int v = 0; v < size; ++v) {
+        int component_size = 0;
+        for (int u = 0; u < size; ++u) {
+            component_size += oracle.IsConnected(u, v);
+        }
+        if (forest.ComponentSize(v) != component_size ||
+            static_cast<int>(sizes.at(forest.ComponentId(v))) != component_size) {
+            throw;
+        }
+    }
+
+    std::cout << "TEST COMPONENT EVENTS: SUCCESS" << std::endl;
+}
+
+void TestExpiry(const uint32_t random_seed = 998) {
+    int size = 1'000;
+    int steps_cnt = 3'000;
+    int count_checks = 100;
+
+    DynamicForest forest{size};
+    ReferenceForest oracle{size};
+    std::mt19937 rng{random_seed};
+    std::unordered_map<uint64_t, uint64_t> expiries;
+    auto key = [](int u, int v) {
+        return (static_cast<uint64_t>(std::min(u, v)) << 32) | static_cast<uint64_t>(std::max(u, v));
+    };
+
+    for (int step = 0; step < steps_cnt; ++step) {
+        for (int op_num = rng() % 8; op_num > 0; --op_num) {
+            int u = rng() % size;
+            int v = rng() % size;
+            auto kind = rng() % 20;
+            if (kind < 14 && !oracle.IsConnected(u, v)) {
+                if (kind < 10) {
+                    auto expiry = forest.Now() + rng() % 30;
+                    forest.AddEdge(u, v, expiry);
+                    expiries[key(u, v)] = expiry;
+                } else {
+                    forest.AddEdge(u, v);
+                }
+                oracle.AddEdge(u, v);
+            } else if (kind < 18 && oracle.EdgesNumber()) {
+                auto [from, to] = oracle.RandomEdge(rng);
+                forest.RemoveEdge(from, to);
+                oracle.RemoveEdge(from, to);
+                expiries.erase(key(from, to));
+            } else if (kind < 19) {
+                //  a rolled back cut keeps the deadline of a timed edge
+                if (oracle.EdgesNumber()) {
+                    auto [from, to] = oracle.RandomEdge(rng);
+                    forest.Begin();
+                    forest.RemoveEdge(from, to);
+                    forest.Rollback();
+                }
+            } else {
+                for (int w = 0; w < size; ++w) {
+                    if (oracle.HasEdge(u, w)) {
+                        expiries.erase(key(u, w));
+                    }
+                }
+                forest.RemoveVertex(u);
+                oracle.IsolateVertex(u);
+                [[maybe_unused]] int id = forest.AddVertex();
+                assert(id == u);
+            }
+        }
+
+        auto time = forest.Now() + rng() % 3;
+        std::vector<uint64_t> due;
+        for (auto [edge, expiry] : expiries) {
+            if (expiry <= time) {
+                due.push_back(edge);
+            }
+        }
+        for (auto edge : due) {
+            oracle.RemoveEdge(static_cast<int>(edge >> 32), static_cast<int>(edge & 0xFFFFFFFF));
+            expiries.erase(edge);
+        }
+        if (forest.AdvanceTime(time) != due.size()) {
+            throw;
+        }
+        assert(forest.GetComponentsNumber() == oracle.GetComponentsNumber());
+
+        for (int check_iter = 0; check_iter < count_checks; ++check_iter) {
+            int u = rng() % size;
+            int v = check_iter % 2 ? rng() % size : oracle.RandomNeighbour(u, rng);
+            if (oracle.IsConnected(u, v) != forest.IsConnected(u, v)) {
+                throw;
+            }
+        }
+    }
+
+    std::cout << "TEST EXPIRY: SUCCESS" << std::endl;
+}
+
+template<uint32_t MaxVertices>
+void TestCompactRandom(const uint32_t random_seed, int size, int queries_cnt, int count_checks) {
+    CompactForest<MaxVertices> forest{size};
+    ReferenceForest oracle{size};
+    std::mt19937 rng{random_seed};
+
+    for (int iter_num = 0; iter_num < queries_cnt; ++iter_num) {
+        int u = rng() % size;
+        int v = rng() % size;
+        if (rng() % 5 < 3 && u != v && !oracle.IsConnected(u, v)) {
+            forest.AddEdge(u, v);
+            oracle.AddEdge(u, v);
+        } else if (oracle.EdgesNumber()) {
+            auto [from, to] = oracle.RandomEdge(rng);
+            forest.RemoveEdge(from, to);
+            oracle.RemoveEdge(from, to);
+        }
+        assert(forest.GetComponentsNumber() == oracle.GetComponentsNumber());
+
+        for (int check_iter = 0; check_iter < count_checks; ++check_iter) {
+            u = rng() % size;
+            v = rng() % size;
+            if (oracle.IsConnected(u, v) != forest.IsConnected(u, v)) {
+                throw;
+            }
+        }
+    }
+}
+
+void TestCompact(const uint32_t random_seed = 998) {
+    static_assert(sizeof(CompactForest<300>::Node) == 12);
+    static_assert(sizeof(CompactForest<300>::Key) == 4);
+    static_assert(sizeof(CompactForest<(1 << 15)>::Node) == 12);
+    static_assert(sizeof(CompactForest<(1 << 15) + 1>::Node) == 20);
+    static_assert(sizeof(CompactForest<(1 << 17)>::Key) == 8);
+
+    TestCompactRandom<2>(random_seed, 2, 100, 4);
+    TestCompactRandom<300>(random_seed, 300, 3'000, 100);
+    TestCompactRandom<(1 << 15)>(random_seed, 20'000, 3'000, 20);
+    TestCompactRandom<100'000>(random_seed, 100'000, 1'000, 20);
+
+    std::cout << "TEST COMPACT: SUCCESS" << std::endl;
+}
+
+void TestComponentIteration(const uint32_t random_seed = 998) {
+    int size = 3'000;
+
+    DynamicForest forest{size};
+    ReferenceForest oracle{size};
+    std::mt19937 rng{random_seed};
+    for (int iter_num = 0; iter_num < 2 * size; ++iter_num) {
+        int u = rng() % size;
+        int v = rng() % size;
+        if (rng() % 4 && !oracle.IsConnected(u, v)) {
+            forest.AddEdge(u, v);
+            oracle.AddEdge(u, v);
+        } else if (oracle.EdgesNumber()) {
+            auto [from, to] = oracle.RandomEdge(rng);
+            forest.RemoveEdge(from, to);
+            oracle.RemoveEdge(from, to);
+        }
+    }
+
+    for (int check_iter = 0; check_iter < 50; ++check_iter) {
+        int v = rng() % size;
+        std::vector<int> component;
+        forest.ForEachVertexInComponent(v, [&](int u) {
+            component.push_back(u);
+        });
+        std::sort(component.begin(), component.end());
+        assert(std::unique(component.begin(), component.end()) == component.end());
+
+        std::vector<int> expected;
+        for (int u = 0; u < size; ++u) {
+            if (oracle.IsConnected(u, v)) {
+                expected.push_back(u);
+            }
+        }
+        assert(component == expected);
+
+        int arcs_count = 0;
+        [[maybe_unused]] int previous = -1;
+        for (const auto& arc : forest.ComponentTour(v)) {
+            assert(previous == -1 || previous == arc.from);
+            assert(oracle.HasEdge(arc.from, arc.to));
+            previous = arc.to;
+            ++arcs_count;
+        }
+        assert(arcs_count == 2 * (static_cast<int>(expected.size()) - 1));
+    }
+
+    std::cout << "TEST COMPONENT ITERATION: SUCCESS" << std::endl;
+}
+
+void TestComponentSelection(const uint32_t random_seed = 998) {
+    int size = 600;
+    int steps_cnt = 1'500;
+
+    std::mt19937 rng{random_seed};
+    std::vector<std::pair<int, int>> initial;
+    {
+        ReferenceForest dsu{size};
+        for (int it = 0; it < size / 2; ++it) {
+            int u = rng() % size;
+            int v = rng() % size;
+            if (!dsu.IsConnected(u, v)) {
+                dsu.AddEdge(u, v);
+                initial.emplace_back(u, v);
+            }
+        }
+    }
+    auto forest = DynamicForest::Build(size, initial);
+    ReferenceForest oracle{size};
+    for (auto [u, v] : initial) {
+        oracle.AddEdge(u, v);
+    }
+
+    auto check = [&](int v) {
+        std::vector<int> expected;
+        for (int u = 0; u < size; ++u) {
+            if (oracle.IsConnected(u, v)) {
+                expected.push_back(u);
+            }
+        }
+        auto component_size = static_cast<uint32_t>(expected.size());
+        std::vector<int> selected;
+        for (uint32_t k = 0; k < component_size; ++k) {
+            int u = forest.KthInComponent(v, k);
+            assert(forest.RankInComponent(u) == k);
+            selected.push_back(u);
+        }
+        std::sort(selected.begin(), selected.end());
+        if (selected != expected) {
+            throw;
+        }
+        [[maybe_unused]] int sample = forest.SampleVertex(v, rng);
+        assert(oracle.IsConnected(sample, v));
+    };
+
+    for (int step = 0; step < steps_cnt; ++step) {
+        bool transaction = step % 5 == 0;
+        ReferenceForest what_if = oracle;
+        if (transaction) {
+            forest.Begin();
+        }
+        for (int op_num = transaction ? 1 + rng() % 6 : 1; op_num > 0; --op_num) {
+            int u = rng() % size;
+            int v = rng() % size;
+            auto kind = rng() % 10;
+            if (kind < 5 && !what_if.IsConnected(u, v)) {
+                forest.AddEdge(u, v);
+                what_if.AddEdge(u, v);
+            } else if (kind < 9 && what_if.EdgesNumber()) {
+                auto [from, to] = what_if.RandomEdge(rng);
+                forest.RemoveEdge(from, to);
+                what_if.RemoveEdge(from, to);
+            } else {
+                forest.RemoveVertex(u);
+                what_if.IsolateVertex(u);
+                [[maybe_unused]] int id = forest.AddVertex();
+                assert(id == u);
+            }
+        }
+        if (!transaction || rng() % 2) {
+            if (transaction) {
+                forest.Commit();
+            }
+            oracle = what_if;
+        } else {
+            forest.Rollback();
+        }
+        check(rng() % size);
+    }
+
+    //  every vertex of a component is drawn about equally often
+    int v = 0;
+    for (int u = 1; u < size; ++u) {
+        if (forest.ComponentSize(u) > forest.ComponentSize(v)) {
+            v = u;
+        }
+    }
+    int draws = 2'000 * forest.ComponentSize(v);
+    std::unordered_map<int, int> hits;
+    for (int it = 0; it < draws; ++it) {
+        ++hits[forest.SampleVertex(v, rng)];
+    }
+    assert(static_cast<int>(hits.size()) == forest.ComponentSize(v));
+    for (auto [u, count] : hits) {
+        if (count < 1'700 || count > 2'300) {
+            throw;
+        }
+    }
+
+    std::cout << "TEST COMPONENT SELECTION: SUCCESS" << std::endl;
+}
+
+void TestEdgeListLoader(const uint32_t random_seed = 998) {
+    int size = 5'000;
+    std::mt19937 rng{random_seed};
+
+    ReferenceForest oracle{size};
+    std::vector<std::pair<int, int>> edges;
+    for (int v = 1; v < size; ++v) {
+        if (rng() % 5) {
+            int anc = rng() % v;
+            oracle.AddEdge(anc, v);
+            edges.emplace_back(anc, v);
+        }
+    }
+    std::shuffle(edges.begin(), edges.end(), rng);
+
+    auto directory = std::filesystem::temp_directory_path();
+    auto text_path = (directory / "dynamic_forest_edges.txt").string();
+    auto binary_path = (directory / "dynamic_forest_edges.bin").string();
+    {
+        std::ofstream text{text_path};
+        text << "# random forest\n";
+        for (auto [u, v] : edges) {
+            text << u << ' ' << v << '\n';
+            if (rng() % 4 == 0) {
+                text << v << "\t" << u << "\r\n";
+            }
+        }
+        text << (size - 1) << ' ' << (size - 1) / 2;
+        oracle.AddEdge(size - 1, (size - 1) / 2);
+        edges.emplace_back(size - 1, (size - 1) / 2);
+    }
+    {
+        std::ofstream binary{binary_path, std::ios::binary};
+        for (auto [u, v] : edges) {
+            uint32_t ends[2] = {static_cast<uint32_t>(u), static_cast<uint32_t>(v)};
+            binary.write(reinterpret_cast<const char*>(ends), sizeof(ends));
+        }
+    }
+
+    for (unsigned threads : {1u, 3u, 8u}) {
+        for (auto format : {EdgeListFormat::Text, EdgeListFormat::Binary}) {
+            auto path = format == EdgeListFormat::Text ? text_path : binary_path;
+            auto forest = LoadForest(path, format, size, threads);
+            assert(forest.GetComponentsNumber() == oracle.GetComponentsNumber());
+            for (int check_iter = 0; check_iter < 2'000; ++check_iter) {
+                int u = rng() % size;
+                int v = rng() % size;
+                if (forest.IsConnected(u, v) != oracle.IsConnected(u, v)) {
+                    throw;
+                }
+            }
+            auto [u, v] = oracle.RandomEdge(rng);
+            forest.RemoveEdge(u, v);
+            assert(!forest.IsConnected(u, v));
+        }
+    }
+
+    {
+        std::ofstream text{text_path};
+        text << "0 1\n1 2\n2 0\n";
+    }
+    [[maybe_unused]] bool rejected = false;
+    try {
+        LoadForest(text_path, EdgeListFormat::Text);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    //  only '#' and '%' start comments; any other line that is not "u v" names its line number
+    for (std::string bad : {"-1 2", "a b", "3", "99999999999999999999 1"}) {
+        {
+            std::ofstream text{text_path};
+            text << "% header\n0 1\n\n# comment\n" << bad << "\n1 2\n";
+        }
+        std::string message;
+        try {
+            ReadEdgeList(text_path, EdgeListFormat::Text, 2);
+        } catch (const std::runtime_error& error) {
+            message = error.what();
+        }
+        if (message.find("line 5") == std::string::npos) {
+            throw;
+        }
+    }
+
+    std::filesystem::remove(text_path);
+    std::filesystem::remove(binary_path);
+    std::cout << "TEST EDGE LIST LOADER: SUCCESS" << std::endl;
+}
+
+void TestQueryServer(const uint32_t random_seed = 998) {
+    int size = 2'000;
+    std::mt19937 rng{random_seed};
+
+    auto path = (std::filesystem::temp_directory_path() / "dynamic_forest_test.sock").string();
+    DynamicForest served{size};
+    DynamicForest local{size};
+    QueryServer server{served, path};
+    std::thread serving([&server] {
+        server.Run();
+    });
+
+    //  the two clients take turns with fully answered chunks, so the server sees one order
+    QueryClient first{path};
+    QueryClient second{path};
+    std::vector<QueryAnswer> expected;
+    std::vector<QueryAnswer> answers(512);
+    for (int chunk = 0; chunk < 200; ++chunk) {
+        auto& client = chunk % 2 ? second : first;
+        expected.clear();
+        for (int step = 0; step < 256; ++step) {
+            auto kind = rng() % 10;
+            int u = rng() % (size + 1);
+            int v = kind < 5 ? rng() % size : u / 2;
+            auto op = kind < 3 ? QueryOp::Link : kind < 5 ? QueryOp::Connected : QueryOp::Cut;
+            if (kind == 9) {
+                op = static_cast<QueryOp>(3);
+            }
+            client.Send(op, u, v);
+
+            if (u >= size || op > QueryOp::Cut) {
+                expected.push_back(QueryAnswer::Rejected);
+            } else if (op == QueryOp::Connected) {
+                expected.push_back(local.IsConnected(u, v) ? QueryAnswer::Yes : QueryAnswer::No);
+            } else if (op == QueryOp::Link) {
+                bool valid = u != v && !local.IsConnected(u, v);
+                if (valid) {
+                    local.AddEdge(u, v);
+                }
+                expected.push_back(valid ? QueryAnswer::Yes : QueryAnswer::Rejected);
+            } else {
+                bool valid = local.HasEdge(u, v);
+                if (valid) {
+                    local.RemoveEdge(u, v);
+                }
+                expected.push_back(valid ? QueryAnswer::Yes : QueryAnswer::Rejected);
+            }
+        }
+        client.Flush();
+        for (size_t received = 0; received < expected.size();) {
+            size_t count = client.Receive({answers.data(), expected.size() - received});
+            for (size_t idx = 0; idx < count; ++idx) {
+                if (answers[idx] != expected[received + idx]) {
+                    throw;
+                }
+            }
+            received += count;
+        }
+    }
+
+    server.Stop();
+    serving.join();
+    assert(served.GetComponentsNumber() == local.GetComponentsNumber());
+    std::cout << "TEST QUERY SERVER: SUCCESS" << std::endl;
+}
+
+void TestConcurrent(const uint32_t random_seed = 998) {
+    int size = 20'000;
+    int threads = 4;
+    ConcurrentDynamicForest forest{size};
+
+    //  every thread only cuts edges it linked itself, so the surviving edges are known at the end
+    std::vector<std::vector<std::pair<int, int>>> linked(threads);
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < threads; ++thread) {
+        workers.emplace_back([&, thread] {
+            std::mt19937 rng(random_seed + thread);
+            auto& edges = linked[thread];
+            int begin = size / threads * thread;
+            for (int it = 0; it < 40'000; ++it) {
+                //  half of the work stays inside the thread's own range, half crosses ranges
+                bool local = it % 2;
+                int u = local ? begin + rng() % (size / threads) : rng() % size;
+                int v = local ? begin + rng() % (size / threads) : rng() % size;
+                if (edges.empty() || rng() % 3) {
+                    if (forest.AddEdge(u, v)) {
+                        edges.emplace_back(u, v);
+                    }
+                } else {
+                    auto idx = rng() % edges.size();
+                    std::swap(edges[idx], edges.back());
+                    auto [from, to] = edges.back();
+                    edges.pop_back();
+                    if (!forest.RemoveEdge(to, from)) {
+                        throw;
+                    }
+                }
+                forest.IsConnected(u, v);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ReferenceForest oracle{size};
+    for (auto& edges : linked) {
+        for (auto [u, v] : edges) {
+            oracle.AddEdge(u, v);
+        }
+    }
+    assert(forest.GetComponentsNumber() == oracle.GetComponentsNumber());
+    std::mt19937 rng{random_seed};
+    for (int check_iter = 0; check_iter < 20'000; ++check_iter) {
+        int u = rng() % size;
+        int v = check_iter % 2 ? rng() % size : oracle.RandomNeighbour(u, rng);
+        if (forest.IsConnected(u, v) != oracle.IsConnected(u, v)) {
+            throw;
+        }
+    }
+    std::cout << "TEST CONCURRENT: SUCCESS" << std::endl;
+}
+
+//  bridges by Tarjan's lowlink DFS, then the 2-edge-connected components without them
+void BruteForceBridges(int size, const std::vector<std::pair<int, int>>& edges,
+                       std::vector<std::vector<bool>>& bridge, std::vector<int>& component) {
+    std::vector<std::vector<std::pair<int, int>>> graph(size);
+    for (size_t idx = 0; idx < edges.size(); ++idx) {
+        graph[edges[idx].first].emplace_back(edges[idx].second, idx);
+        graph[edges[idx].second].emplace_back(edges[idx].first, idx);
+    }
+    bridge.assign(size, std::vector<bool>(size, false));
+    std::vector<int> enter(size, -1), low(size);
+    int timer = 0;
+    std::function<void(int, int)> dfs = [&](int v, int parent_edge) {
+        enter[v] = low[v] = timer++;
+        for (auto [u, idx] : graph[v]) {
+            if (idx == parent_edge) {
+                continue;
+            }
+            if (enter[u] != -1) {
+                low[v] = std::min(low[v], enter[u]);
+            } else {
+                dfs(u, idx);
+                low[v] = std::min(low[v], low[u]);
+                if (low[u] > enter[v]) {
+                    bridge[u][v] = bridge[v][u] = true;
+                }
+            }
+        }
+    };
+    for (int v = 0; v < size; ++v) {
+        if (enter[v] == -1) {
+            dfs(v, -1);
+        }
+    }
+    component.assign(size, -1);
+    for (int v = 0; v < size; ++v) {
+        if (component[v] != -1) {
+            continue;
+        }
+        std::vector<int> stack{v};
+        component[v] = v;
+        while (!stack.empty()) {
+            int x = stack.back();
+            stack.pop_back();
+            for (auto [u, idx] : graph[x]) {
+                if (component[u] == -1 && !bridge[x][u]) {
+                    component[u] = v;
+                    stack.push_back(u);
+                }
+            }
+        }
+    }
+}
+
+void TestDynamicGraph(const uint32_t random_seed = 998) {
+    int size = 40;
+    std::mt19937 rng{random_seed};
+    DynamicGraph graph{size};
+    SimpleGraph simple{size};
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::vector<bool>> bridge;
+    std::vector<int> component;
+
+    for (int it = 0; it < 3'000; ++it) {
+        //  the edge count drifts between sparse forests and graphs with many cycles
+        bool grow = (it / 500) % 2 == 0 ? rng() % 4 != 0 : rng() % 4 == 0;
+        if (grow || edges.empty()) {
+            int u = rng() % size;
+            int v = rng() % size;
+            std::pair edge{std::min(u, v), std::max(u, v)};
+            bool fresh = u != v && std::find(edges.begin(), edges.end(), edge) == edges.end();
+            if (graph.AddEdge(u, v) != fresh) {
+                throw;
+            }
+            if (fresh) {
+                edges.push_back(edge);
+                simple.AddEdge(u, v);
+            }
+        } else {
+            auto idx = rng() % edges.size();
+            std::swap(edges[idx], edges.back());
+            auto [u, v] = edges.back();
+            edges.pop_back();
+            if (!graph.RemoveEdge(v, u) || graph.RemoveEdge(u, v)) {
+                throw;
+            }
+            simple.RemoveEdge(u, v);
+        }
+
+        simple.CalculateConnectMatrix();
+        BruteForceBridges(size, edges, bridge, component);
+        for (auto [u, v] : edges) {
+            if (graph.IsBridge(u, v) != bridge[u][v] || graph.IsBridge(v, u) != bridge[u][v]) {
+                throw;
+            }
+        }
+        for (int check_iter = 0; check_iter < 20; ++check_iter) {
+            int u = rng() % size;
+            int v = rng() % size;
+            if (graph.IsConnected(u, v) != simple.IsConnected(u, v) ||
+                graph.Is2EdgeConnected(u, v) != (component[u] == component[v])) {
+                throw;
+            }
+        }
+        int components = 0;
+        for (int v = 0; v < size; ++v) {
+            int u = 0;
+            while (!simple.IsConnected(u, v)) {
+                ++u;
+            }
+            components += u == v;
+        }
+        assert(graph.GetComponentsNumber() == components);
+    }
+    std::cout << "TEST DYNAMIC GRAPH: SUCCESS" << std::endl;
+}
+
+void TestBipartite(const uint32_t random_seed = 998) {
+    int size = 40;
+    std::mt19937 rng{random_seed};
+    BipartiteGraph graph{size};
+    std::vector<std::pair<int, int>> edges;
+
+    //  BFS 2-coloring of the whole graph against the answers on random pairs
+    auto check = [&]() {
+        std::vector<std::vector<int>> adjacency(size);
+        for (auto [u, v] : edges) {
+            adjacency[u].push_back(v);
+            adjacency[v].push_back(u);
+        }
+        std::vector<int> color(size, -1), component(size), odd(size, 0);
+        for (int root = 0; root < size; ++root) {
+            if (color[root] != -1) {
+                continue;
+            }
+            std::vector<int> queue{root};
+            color[root] = 0;
+            for (size_t head = 0; head < queue.size(); ++head) {
+                int x = queue[head];
+                component[x] = root;
+                for (int y : adjacency[x]) {
+                    if (color[y] == -1) {
+                        color[y] = color[x] ^ 1;
+                        queue.push_back(y);
+                    } else if (color[y] == color[x]) {
+                        odd[root] = 1;
+                    }
+                }
+            }
+        }
+        for (int check_iter = 0; check_iter < 20; ++check_iter) {
+            int u = rng() % size;
+            int v = rng() % size;
+            bool connected = component[u] == component[v];
+            bool bipartite = !odd[component[u]];
+            if (graph.IsConnected(u, v) != connected || graph.IsBipartite(u) != bipartite ||
+                graph.SameSide(u, v) != (connected && bipartite && color[u] == color[v])) {
+                throw;
+            }
+        }
+    };
+
+    for (int it = 0; it < 3'000; ++it) {
+        bool grow = (it / 300) % 2 == 0 ? rng() % 3 != 0 : rng() % 3 == 0;
+        if (grow || edges.empty()) {
+            int u = rng() % size;
+            int v = rng() % 50 ? rng() % size : u;
+            std::pair edge{std::min(u, v), std::max(u, v)};
+            bool fresh = std::find(edges.begin(), edges.end(), edge) == edges.end();
+            if (graph.AddEdge(v, u) != fresh) {
+                throw;
+            }
+            if (fresh) {
+                edges.push_back(edge);
+            }
+        } else {
+            auto idx = rng() % edges.size();
+            std::swap(edges[idx], edges.back());
+            auto [u, v] = edges.back();
+            edges.pop_back();
+            if (!graph.RemoveEdge(u, v) || graph.HasEdge(v, u)) {
+                throw;
+            }
+        }
+        check();
+    }
+
+    //  a dense cut: the complete bipartite graph between the halves has 400 edges across, each
+    //  tree edge of the cover lost to a deletion has hundreds of replacement candidates, and
+    //  an odd edge inside one half comes and goes on the way down
+    while (!edges.empty()) {
+        auto [u, v] = edges.back();
+        edges.pop_back();
+        graph.RemoveEdge(u, v);
+    }
+    for (int u = 0; u < size / 2; ++u) {
+        for (int v = size / 2; v < size; ++v) {
+            graph.AddEdge(u, v);
+            edges.emplace_back(u, v);
+        }
+    }
+    std::shuffle(edges.begin(), edges.end(), rng);
+    for (int it = 0; !edges.empty(); ++it) {
+        if (it % 40 == 20) {
+            graph.AddEdge(0, 1);
+            edges.insert(edges.end() - std::min<size_t>(edges.size(), 10), {0, 1});
+        }
+        auto [u, v] = edges.back();
+        edges.pop_back();
+        if (!graph.RemoveEdge(u, v)) {
+            throw;
+        }
+        check();
+    }
+    std::cout << "TEST BIPARTITE: SUCCESS" << std::endl;
+}
+
+void TestWeighted(const uint32_t random_seed = 998) {
+    int size = 30;
+    std::mt19937 rng{random_seed};
+    WeightedForest forest{size};
+    std::vector<std::vector<int64_t>> weight(size, std::vector<int64_t>(size, -1));
+    std::vector<std::pair<int, int>> edges;
+
+    for (int it = 0; it < 4'000; ++it) {
+        auto distances = [&](int source) {
+            std::vector<int64_t> distance(size, -1);
+            std::vector<int> stack{source};
+            distance[source] = 0;
+            while (!stack.empty()) {
+                int x = stack.back();
+                stack.pop_back();
+                for (int y = 0; y < size; ++y) {
+                    if (weight[x][y] >= 0 && distance[y] < 0) {
+                        distance[y] = distance[x] + weight[x][y];
+                        stack.push_back(y);
+                    }
+                }
+            }
+            return distance;
+        };
+
+        int u = rng() % size;
+        int v = rng() % size;
+        if (rng() % 3 && distances(u)[v] < 0) {
+            int64_t w = rng() % 4 ? rng() % 100 : 0;
+            forest.AddEdge(u, v, w);
+            weight[u][v] = weight[v][u] = w;
+            edges.emplace_back(u, v);
+        } else if (!edges.empty()) {
+            auto idx = rng() % edges.size();
+            std::swap(edges[idx], edges.back());
+            auto [from, to] = edges.back();
+            edges.pop_back();
+            forest.RemoveEdge(to, from);
+            weight[from][to] = weight[to][from] = -1;
+        }
+
+        for (int check_iter = 0; check_iter < 3; ++check_iter) {
+            int x = rng() % size;
+            auto from_x = distances(x);
+            int64_t eccentricity = *std::max_element(from_x.begin(), from_x.end());
+            auto [far, far_distance] = forest.Farthest(x);
+            if (far_distance != eccentricity || from_x[far] != eccentricity) {
+                throw;
+            }
+
+            int64_t diameter = 0;
+            int64_t radius = std::numeric_limits<int64_t>::max();
+            for (int y = 0; y < size; ++y) {
+                if (from_x[y] >= 0) {
+                    auto from_y = distances(y);
+                    int64_t y_eccentricity = *std::max_element(from_y.begin(), from_y.end());
+                    diameter = std::max(diameter, y_eccentricity);
+                    radius = std::min(radius, y_eccentricity);
+                }
+            }
+            int center = forest.Center(x);
+            auto from_center = distances(center);
+            if (forest.Diameter(x) != diameter || from_x[center] < 0 ||
+                *std::max_element(from_center.begin(), from_center.end()) != radius) {
+                throw;
+            }
+            if (forest.IsConnected(x, u) != (from_x[u] >= 0)) {
+                throw;
+            }
+        }
+        assert(forest.GetComponentsNumber() == size - static_cast<int>(edges.size()));
+    }
+    std::cout << "TEST WEIGHTED: SUCCESS" << std::endl;
+}
+
+void TestSharedForest(const uint32_t random_seed = 998) {
+    int size = 5'000;
+    int frozen = 1'000;
+    std::mt19937 rng{random_seed};
+    auto name = "/dynamic_forest_test_" + std::to_string(getpid());
+    auto writer = SharedForest::Create(name, size);
+    ReferenceForest oracle{size};
+    uint64_t updates = 0;
+    auto link_random = [&](int begin, int end) {
+        int u = begin + rng() % (end - begin);
+        int v = begin + rng() % (end - begin);
+        if (u != v && !oracle.IsConnected(u, v)) {
+            writer.AddEdge(u, v);
+            oracle.AddEdge(u, v);
+            ++updates;
+        }
+    };
+    for (int it = 0; it < 3 * size; ++it) {
+        link_random(0, frozen);
+        link_random(frozen, size);
+    }
+
+    //  no edge leaves the vertices below `frozen` and their edges stay, so a reader racing
+    //  with the writer must see fixed answers there
+    std::vector<std::tuple<int, int, bool>> fixed;
+    for (int it = 0; it < 2'000; ++it) {
+        int u = rng() % frozen;
+        int v = rng() % frozen;
+        fixed.emplace_back(u, v, oracle.IsConnected(u, v));
+    }
+    //  the pairs above `frozen` change under the reader: the writer records the oracle's
+    //  answers for them as a bit mask per version before it publishes that version, and an
+    //  answer is right if some version the query overlapped agrees with it
+    constexpr int kMoving = 64;
+    //  the writer goes on past kRounds until some answer raced with an update, so the
+    //  retry path is known to have run
+    constexpr int kRounds = 20'000;
+    constexpr int kMaxRounds = 200'000;
+    std::vector<std::pair<int, int>> moving;
+    for (int it = 0; it < kMoving; ++it) {
+        moving.emplace_back(frozen + rng() % (size - frozen), frozen + rng() % (size - frozen));
+    }
+    auto moving_mask = [&] {
+        uint64_t mask = 0;
+        for (int idx = 0; idx < kMoving; ++idx) {
+            mask |= static_cast<uint64_t>(oracle.IsConnected(moving[idx].first, moving[idx].second)) << idx;
+        }
+        return mask;
+    };
+    std::vector<std::atomic<uint64_t>> history(updates + kMaxRounds + 1);
+    history[updates].store(moving_mask(), std::memory_order_relaxed);
+    std::atomic<uint64_t> racing_answers{0};
+
+    std::atomic<bool> done{false};
+    std::thread reader_thread([&] {
+        auto reader = SharedForest::Attach(name);
+        for (size_t idx = 0; !done.load(); ++idx) {
+            auto [u, v, expected] = fixed[idx % fixed.size()];
+            if (reader.IsConnected(u, v) != expected) {
+                throw;
+            }
+            auto [moving_u, moving_v] = moving[idx % kMoving];
+            auto before = reader.Version();
+            bool answer = reader.IsConnected(moving_u, moving_v);
+            auto after = reader.Version();
+            bool seen = false;
+            for (auto version = before; version <= after && !seen; ++version) {
+                seen = (history[version].load(std::memory_order_relaxed) >> (idx % kMoving) & 1) == answer;
+            }
+            if (!seen) {
+                throw;
+            }
+            if (before != after) {
+                racing_answers.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+    for (int it = 0; it < kMaxRounds && (it < kRounds || !racing_answers.load()); ++it) {
+        if (rng() % 2) {
+            int u = frozen + rng() % (size - frozen);
+            int v = frozen + rng() % (size - frozen);
+            if (u != v && !oracle.IsConnected(u, v)) {
+                oracle.AddEdge(u, v);
+                history[updates + 1].store(moving_mask(), std::memory_order_relaxed);
+                writer.AddEdge(u, v);
+                ++updates;
+            }
+        } else {
+            auto [u, v] = oracle.RandomEdge(rng);
+            if (u >= frozen && v >= frozen) {
+                oracle.RemoveEdge(u, v);
+                history[updates + 1].store(moving_mask(), std::memory_order_relaxed);
+                writer.RemoveEdge(u, v);
+                ++updates;
+            }
+        }
+    }
+    done = true;
+    reader_thread.join();
+    assert(racing_answers.load() > 0);
+
+    std::vector<std::tuple<int, int, bool>> checks;
+    for (int it = 0; it < 5'000; ++it) {
+        int u = rng() % size;
+        int v = it % 2 ? rng() % size : oracle.RandomNeighbour(u, rng);
+        checks.emplace_back(u, v, oracle.IsConnected(u, v));
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        auto reader = SharedForest::Attach(name);
+        bool same = reader.GetComponentsNumber() == oracle.GetComponentsNumber();
+        for (auto [u, v, expected] : checks) {
+            same = same && reader.IsConnected(u, v) == expected;
+        }
+        _exit(same ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(writer.Version() == updates);
+
+    SharedForest::Remove(name);
+    std::cout << "TEST SHARED FOREST: SUCCESS" << std::endl;
+}
+
 void TestLarge(const uint32_t random_seed = 998) {
     int size = 100'000;
 
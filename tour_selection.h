@@ -0,0 +1,55 @@
+#ifndef DYNAMIC_FOREST_TOUR_SELECTION_H
+#define DYNAMIC_FOREST_TOUR_SELECTION_H
+
+#include <cassert>
+#include <cinttypes>
+
+#include "treap.h"
+
+//  the vertices of an Euler tour by rank. The representative arc of every vertex is marked and
+//  each treap vertex counts the marks in its subtree, so the k-th vertex of a tour and the rank
+//  of a vertex are one walk of the treap each. A mark moves with its representative through
+//  SetMark, which refreshes the counts up to the root.
+namespace tour_selection {
+    template<typename Vertex, typename Observer>
+    void SetMark(Vertex* vertex, uint32_t marked, Observer&& observer) {
+        observer.Touch(vertex);
+        vertex->data.marked = marked;
+        treap::PullToRoot(vertex, observer);
+    }
+
+    //  the vertex of the k-th marked arc under root, counting from 0
+    template<typename Vertex>
+    int Kth(Vertex* root, uint32_t k) {
+        assert(k < root->data.marks);
+        auto vertex = root;
+        while (true) {
+            auto left_marks = vertex->left_son ? vertex->left_son->data.marks : 0;
+            if (k < left_marks) {
+                vertex = vertex->left_son;
+                continue;
+            }
+            k -= left_marks;
+            if (k < vertex->data.marked) {
+                return vertex->data.from;
+            }
+            k -= vertex->data.marked;
+            vertex = vertex->right_son;
+        }
+    }
+
+    //  how many marked arcs precede the given one in its tour
+    template<typename Vertex>
+    uint32_t Rank(Vertex* vertex) {
+        uint32_t rank = vertex->left_son ? vertex->left_son->data.marks : 0;
+        for (; vertex->ancestor; vertex = vertex->ancestor) {
+            auto ancestor = vertex->ancestor;
+            if (ancestor->right_son == vertex) {
+                rank += ancestor->data.marked + (ancestor->left_son ? ancestor->left_son->data.marks : 0);
+            }
+        }
+        return rank;
+    }
+}
+
+#endif //DYNAMIC_FOREST_TOUR_SELECTION_H
@@ -1,8 +1,36 @@
 #ifndef DYNAMIC_FOREST_TREAP_H
 #define DYNAMIC_FOREST_TREAP_H
 
+#include <atomic>
+#include <cassert>
 #include <cinttypes>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
 #include <utility>
+#include <vector>
+
+
+namespace treap {
+    //  observers are told about a vertex right before any of its links or its size change;
+    //  the default one compiles away
+    struct NoObserver {
+        template<typename Vertex>
+        void Touch(Vertex*) {}
+    };
+
+    //  data with a subtree aggregate: Aggregate gets the sons' data (nullptr for a missing son)
+    //  every time the vertex is updated; other data types pay nothing
+    template<typename DataType>
+    concept Aggregated = requires(DataType data, const DataType* son) {
+        data.Aggregate(son, son);
+    };
+
+    //  data whose treaps are walked up without a lock while another thread changes them sets
+    //  kAtomicAncestor; every other treap keeps plain ancestor stores
+    template<typename DataType>
+    concept AtomicAncestor = DataType::kAtomicAncestor;
+}
 
 
 template<typename DataType>
@@ -35,13 +63,47 @@ struct TreapVertex {
     }
 
     void Update() {
+        Update(treap::NoObserver{});
+    }
+
+    //  recomputes what depends on the sons, links are left alone
+    void Pull() {
         size_of_treap = 1 + LeftSize() + RightSize();
-        ancestor = nullptr;  //  update ancestor from ancestor
+        if constexpr (treap::Aggregated<DataType>) {
+            data.Aggregate(left_son ? &left_son->data : nullptr, right_son ? &right_son->data : nullptr);
+        }
+    }
+
+    template<typename Observer>
+    void Update(Observer&& observer) {
+        observer.Touch(this);
+        Pull();
+        SetAncestor(nullptr);  //  update ancestor from ancestor
         if (left_son) {
-            left_son->ancestor = this;
+            observer.Touch(left_son);
+            left_son->SetAncestor(this);
         }
         if (right_son) {
-            right_son->ancestor = this;
+            observer.Touch(right_son);
+            right_son->SetAncestor(this);
+        }
+    }
+
+    //  for an AtomicAncestor treap a release store, so a walk that reaches a freshly built
+    //  vertex also sees the vertex initialized
+    void SetAncestor(TreapVertex* value) {
+        if constexpr (treap::AtomicAncestor<DataType>) {
+            std::atomic_ref{ancestor}.store(value, std::memory_order_release);
+        } else {
+            ancestor = value;
+        }
+    }
+
+    TreapVertex* LoadAncestor() {
+        if constexpr (treap::AtomicAncestor<DataType>) {
+            return std::atomic_ref{ancestor}.load(std::memory_order_acquire);
+        } else {
+            return ancestor;
         }
     }
 };
@@ -67,45 +129,173 @@ namespace treap {
         return vertex;
     }
 
+    //  walks all the vertices to their roots in lock-step, so the cache misses
+    //  of independent walks overlap instead of being paid one after another
     template<typename DataType>
-    uint32_t PosNumberInTreap(TreapVertex<DataType>* vertex) {
+    void GetTreapRoots(TreapVertex<DataType>** vertices, size_t count) {
+        for (size_t idx = 0; idx < count; ++idx) {
+            if (vertices[idx]) {
+                __builtin_prefetch(vertices[idx]);
+            }
+        }
+        bool active = true;
+        while (active) {
+            active = false;
+            for (size_t idx = 0; idx < count; ++idx) {
+                auto vertex = vertices[idx];
+                if (vertex && vertex->ancestor) {
+                    vertex = vertex->ancestor;
+                    __builtin_prefetch(vertex);
+                    vertices[idx] = vertex;
+                    active = true;
+                }
+            }
+        }
+    }
+
+    //  refreshes the aggregates above a vertex whose own data changed
+    template<typename DataType, typename Observer = NoObserver>
+    void PullToRoot(TreapVertex<DataType>* vertex, Observer&& observer = {}) {
+        while (vertex) {
+            observer.Touch(vertex);
+            vertex->Pull();
+            vertex = vertex->ancestor;
+        }
+    }
+
+    template<typename DataType>
+    TreapVertex<DataType>* FirstInTreap(TreapVertex<DataType>* root) {
+        if (!root) {
+            return nullptr;
+        }
+        while (root->left_son) {
+            root = root->left_son;
+        }
+        return root;
+    }
+
+    //  in-order successor through the parent links, nullptr after the last vertex
+    template<typename DataType>
+    TreapVertex<DataType>* NextInTreap(TreapVertex<DataType>* vertex) {
+        if (vertex->right_son) {
+            return FirstInTreap(vertex->right_son);
+        }
+        while (vertex->ancestor && vertex->ancestor->right_son == vertex) {
+            vertex = vertex->ancestor;
+        }
+        return vertex->ancestor;
+    }
+
+    template<typename DataType>
+    class TreapIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = DataType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const DataType*;
+        using reference = const DataType&;
+
+        TreapIterator() = default;
+
+        explicit TreapIterator(TreapVertex<DataType>* vertex) : vertex_{vertex} {
+        }
+
+        reference operator*() const {
+            return vertex_->data;
+        }
+
+        pointer operator->() const {
+            return &vertex_->data;
+        }
+
+        TreapIterator& operator++() {
+            vertex_ = NextInTreap(vertex_);
+            return *this;
+        }
+
+        TreapIterator operator++(int) {
+            auto old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const TreapIterator& other) const = default;
+
+    private:
+        TreapVertex<DataType>* vertex_{};
+    };
+
+    //  root and position in one walk up. Above a right son the ancestor and its left subtree
+    //  hold size(ancestor) - size(son) vertices, so a step reads only the sizes on the path,
+    //  never a left sibling, and adds them under a mask instead of a branch
+    template<typename DataType>
+    std::pair<TreapVertex<DataType>*, uint32_t> RootAndPos(TreapVertex<DataType>* vertex) {
         if (!vertex) {
-            return 0;
+            return {nullptr, 0};
         }
         uint32_t pos = vertex->LeftSize();
-        while (vertex->ancestor) {
-            if (vertex->ancestor->right_son == vertex) {
-                pos += vertex->ancestor->LeftSize() + 1;
+        while (auto ancestor = vertex->ancestor) {
+            uint32_t mask = 0u - static_cast<uint32_t>(ancestor->right_son == vertex);
+            pos += (ancestor->size_of_treap - vertex->size_of_treap) & mask;
+            vertex = ancestor;
+        }
+        return {vertex, pos};
+    }
+
+    //  positions of two vertices of one treap and its root, the two walks interleaved step by
+    //  step: each walk is a chain of dependent ancestor loads, and two chains in one loop let
+    //  their cache misses overlap instead of paying for them one after the other
+    template<typename DataType>
+    std::tuple<TreapVertex<DataType>*, uint32_t, uint32_t> RootAndPositions(
+            TreapVertex<DataType>* one, TreapVertex<DataType>* two) {
+        uint32_t pos_one = one->LeftSize();
+        uint32_t pos_two = two->LeftSize();
+        auto step = [](TreapVertex<DataType>*& vertex, uint32_t& pos) {
+            auto ancestor = vertex->ancestor;
+            if (!ancestor) {
+                return false;
             }
-            vertex = vertex->ancestor;
+            uint32_t mask = 0u - static_cast<uint32_t>(ancestor->right_son == vertex);
+            pos += (ancestor->size_of_treap - vertex->size_of_treap) & mask;
+            vertex = ancestor;
+            return true;
+        };
+        while (step(one, pos_one) | step(two, pos_two)) {
         }
-        return pos;
+        return {one, pos_one, pos_two};
     }
 
     template<typename DataType>
+    uint32_t PosNumberInTreap(TreapVertex<DataType>* vertex) {
+        return RootAndPos(vertex).second;
+    }
+
+    template<typename DataType, typename Observer = NoObserver>
     std::pair<TreapVertex<DataType>*, TreapVertex<DataType>*>
-    SplitTreap(TreapVertex<DataType> *vertex, uint32_t pivot) {
+    SplitTreap(TreapVertex<DataType> *vertex, uint32_t pivot, Observer&& observer = {}) {
         if (!vertex) {
             return {nullptr, nullptr};
         }
+        observer.Touch(vertex);
         if (vertex->LeftSize() >= pivot) {
-            auto [left, right] = SplitTreap(vertex->left_son, pivot);
+            auto [left, right] = SplitTreap(vertex->left_son, pivot, observer);
             vertex->left_son = right;
-            vertex->Update();
+            vertex->Update(observer);
             return {left, vertex};
         } else {
             uint32_t shift = 1 + vertex->LeftSize();
-            auto [left, right] = SplitTreap(vertex->right_son, pivot - shift);
+            auto [left, right] = SplitTreap(vertex->right_son, pivot - shift, observer);
             vertex->right_son = left;
-            vertex->Update();
+            vertex->Update(observer);
             return {vertex, right};
         }
     }
 
-    template<typename DataType>
+    template<typename DataType, typename Observer = NoObserver>
     TreapVertex<DataType>* MergeTreap(
             TreapVertex<DataType> *left,
-            TreapVertex<DataType> *right) {
+            TreapVertex<DataType> *right,
+            Observer&& observer = {}) {
         if (!left) {
             return right;
         }
@@ -113,42 +303,127 @@ namespace treap {
             return left;
         }
         if (left->treap_priority > right->treap_priority) {
-            left->right_son = MergeTreap(left->right_son, right);
-            left->Update();
+            observer.Touch(left);
+            left->right_son = MergeTreap(left->right_son, right, observer);
+            left->Update(observer);
             return left;
         } else {
-            right->left_son = MergeTreap(left, right->left_son);
-            right->Update();
+            observer.Touch(right);
+            right->left_son = MergeTreap(left, right->left_son, observer);
+            right->Update(observer);
             return right;
         }
     }
 
+    //  builds the treap of the given sequence in O(n): the stack holds the right spine,
+    //  a vertex leaves it only when its subtree is final, so sizes are computed on the way out
     template<typename DataType>
+    TreapVertex<DataType>* BuildTreap(TreapVertex<DataType>** vertices, size_t count) {
+        std::vector<TreapVertex<DataType>*> spine;
+        for (size_t idx = 0; idx < count; ++idx) {
+            auto vertex = vertices[idx];
+            vertex->left_son = nullptr;
+            vertex->right_son = nullptr;
+            TreapVertex<DataType>* last = nullptr;
+            while (!spine.empty() && spine.back()->treap_priority <= vertex->treap_priority) {
+                last = spine.back();
+                spine.pop_back();
+                last->Update();
+            }
+            vertex->left_son = last;
+            if (!spine.empty()) {
+                spine.back()->right_son = vertex;
+            }
+            spine.push_back(vertex);
+        }
+        while (!spine.empty()) {
+            spine.back()->Update();
+            if (spine.size() == 1) {
+                return spine.back();
+            }
+            spine.pop_back();
+        }
+        return nullptr;
+    }
+
+    template<typename DataType, typename Observer = NoObserver>
     TreapVertex<DataType>* InsertInTreap(
-            TreapVertex<DataType>* root, TreapVertex<DataType>* new_vertex, int pos) {
-        auto [left, right] = SplitTreap(root, pos);
-        return MergeTreap(left, MergeTreap(new_vertex, right));
+            TreapVertex<DataType>* root, TreapVertex<DataType>* new_vertex, int pos,
+            Observer&& observer = {}) {
+        auto [left, right] = SplitTreap(root, pos, observer);
+        return MergeTreap(left, MergeTreap(new_vertex, right, observer), observer);
     }
 
-    template<typename DataType>
+    template<typename DataType, typename Observer = NoObserver>
     TreapVertex<DataType>* CycleShiftLeft(
-            TreapVertex<DataType>* root, uint32_t shift) {
-        auto [left, right] = SplitTreap(root, shift);
-        return MergeTreap(right, left);
+            TreapVertex<DataType>* root, uint32_t shift, Observer&& observer = {}) {
+        auto [left, right] = SplitTreap(root, shift, observer);
+        return MergeTreap(right, left, observer);
     }
 
-    template<typename DataType>
+    template<typename DataType, typename Observer = NoObserver>
     TreapVertex<DataType>* MoveToFirstPos(
             TreapVertex<DataType>* vertex,
-            TreapVertex<DataType>* virtual_root = nullptr) {
+            TreapVertex<DataType>* virtual_root = nullptr,
+            Observer&& observer = {}) {
         if (!vertex) {
             return nullptr;
         }
-        uint32_t pos = PosNumberInTreap(vertex);
-        if (!virtual_root) {
-            virtual_root = GetTreapRoot(vertex);
+        auto [root, pos] = RootAndPos(vertex);
+        return CycleShiftLeft(virtual_root ? virtual_root : root, pos, observer);
+    }
+
+    //  Euler-tour link of two tours by the twin arcs (u, v) and (v, u): the tour of u from
+    //  u_vertex on, edge_forward, the tour of v from v_vertex on, edge_backward. A null vertex
+    //  stands for a lone vertex without a tour. Returns the root of the joined tour
+    template<typename DataType, typename Observer = NoObserver>
+    TreapVertex<DataType>* LinkTours(
+            TreapVertex<DataType>* u_vertex, TreapVertex<DataType>* v_vertex,
+            TreapVertex<DataType>* edge_forward, TreapVertex<DataType>* edge_backward,
+            Observer&& observer = {}) {
+        auto u_subtree = MoveToFirstPos(u_vertex, {}, observer);
+        auto v_subtree = MoveToFirstPos(v_vertex, {}, observer);
+        auto augmented_v_tree = MergeTreap(edge_forward, v_subtree, observer);
+        augmented_v_tree = MergeTreap(augmented_v_tree, edge_backward, observer);
+        return MergeTreap(u_subtree, augmented_v_tree, observer);
+    }
+
+    //  Euler-tour cut of the twin arcs of one edge: the arcs between them are the tour of one
+    //  side, the arcs around them the tour of the other. Returns {outer root, inner root},
+    //  the twins are left as single vertices
+    template<typename DataType, typename Observer = NoObserver>
+    std::pair<TreapVertex<DataType>*, TreapVertex<DataType>*> CutTour(
+            TreapVertex<DataType>* edge_one, TreapVertex<DataType>* edge_two,
+            Observer&& observer = {}) {
+        auto [root, pos_one, pos_two] = RootAndPositions(edge_one, edge_two);
+        if (pos_one > pos_two) {
+            std::swap(edge_one, edge_two);
+            std::swap(pos_one, pos_two);
+        }
+        auto [mid, right] = SplitTreap(root, pos_two, observer);
+        [[maybe_unused]] auto [edge_bb, new_right] = SplitTreap(right, 1, observer);
+        auto [left, new_subtree] = SplitTreap(mid, pos_one, observer);
+        [[maybe_unused]] auto [edge_ff, inner] = SplitTreap(new_subtree, 1, observer);
+
+        assert(edge_bb == edge_two);
+        assert(edge_one == edge_ff);
+
+        return {MergeTreap(left, new_right, observer), inner};
+    }
+
+    //  the arc following (x, y) in the cyclic tour always leaves y: when the arc representing
+    //  y is cut, the arc after its twin takes over, and null means y is left without arcs.
+    //  Called before the cut, with the root of the tour
+    template<typename DataType>
+    TreapVertex<DataType>* RepresentativeAfterCut(
+            TreapVertex<DataType>* representative, TreapVertex<DataType>* cut_arc,
+            TreapVertex<DataType>* twin, TreapVertex<DataType>* root) {
+        if (representative != cut_arc) {
+            return representative;
         }
-        return CycleShiftLeft(virtual_root, pos);
+        auto next = NextInTreap(twin);
+        next = next ? next : FirstInTreap(root);
+        return next == cut_arc ? nullptr : next;
     }
 
     /*
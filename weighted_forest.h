@@ -0,0 +1,390 @@
+#ifndef DYNAMIC_FOREST_WEIGHTED_FOREST_H
+#define DYNAMIC_FOREST_WEIGHTED_FOREST_H
+
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//  forest with weighted edges answering diameter, center and farthest vertex queries, kept as a
+//  link-cut tree. Every edge is a node of its own that carries the weight, so distances are sums
+//  of node weights. A splay tree stands for a path plus everything hanging off it (its cluster)
+//  and keeps the farthest vertex from either end of the path and the cluster diameter; the
+//  subtrees hanging off a node through path-parent links sit in two multisets, so every
+//  operation is O(log n) amortized up to the multiset factor. Weights must be non-negative.
+class WeightedForest {
+public:
+    explicit WeightedForest(int vertex_count) : size_{vertex_count}, nodes_(vertex_count) {
+        for (int v_num = 0; v_num < vertex_count; ++v_num) {
+            nodes_[v_num].vertex = v_num;
+            Pull(v_num);
+        }
+    }
+
+    int GetComponentsNumber() const {
+        return size_ - static_cast<int>(edges_.size());
+    }
+
+    void AddEdge(int u_num, int v_num, int64_t weight = 1) {
+        assert(weight >= 0 && !IsConnected(u_num, v_num));
+        int edge = CreateEdgeNode(weight);
+        edges_[EncodeEdge(u_num, v_num)] = edge;
+
+        MakeRoot(u_num);
+        nodes_[u_num].parent = edge;
+        AddVirtual(edge, u_num);
+        Pull(edge);
+
+        Access(v_num);
+        nodes_[edge].parent = v_num;
+        AddVirtual(v_num, edge);
+        Pull(v_num);
+    }
+
+    void RemoveEdge(int u_num, int v_num) {
+        auto iter = edges_.find(EncodeEdge(u_num, v_num));
+        int edge = iter->second;
+        edges_.erase(iter);
+        CutAbove(u_num, edge);
+        CutAbove(v_num, edge);
+        nodes_[edge] = {};
+        free_nodes_.push_back(edge);
+    }
+
+    bool IsConnected(int u_num, int v_num) {
+        return u_num == v_num || FindRoot(u_num) == FindRoot(v_num);
+    }
+
+    //  the longest distance between two vertices of v's tree
+    int64_t Diameter(int v_num) {
+        Access(v_num);
+        return nodes_[v_num].diameter;
+    }
+
+    //  a vertex farthest from v and its distance (the eccentricity of v)
+    std::pair<int, int64_t> Farthest(int v_num) {
+        MakeRoot(v_num);
+        return {nodes_[v_num].head.vertex, nodes_[v_num].head.distance};
+    }
+
+    //  a vertex of v's tree with the smallest eccentricity: it lies on any diameter path,
+    //  at the vertex nearest to the middle
+    int Center(int v_num) {
+        int a_num = Farthest(v_num).first;
+        auto [b_num, diameter] = Farthest(a_num);
+        if (!diameter) {
+            return a_num;
+        }
+        MakeRoot(a_num);
+        Access(b_num);
+
+        //  the first node of the path a..b whose prefix reaches half of the diameter
+        int node = b_num;
+        int64_t before = 0;
+        while (true) {
+            Push(node);
+            auto& current = nodes_[node];
+            int64_t left_sum = current.left < 0 ? 0 : nodes_[current.left].sum;
+            if (current.left >= 0 && 2 * (before + left_sum) >= diameter) {
+                node = current.left;
+            } else if (2 * (before + left_sum + current.weight) >= diameter) {
+                break;
+            } else {
+                before += left_sum + current.weight;
+                node = current.right;
+            }
+        }
+        Splay(node);
+        if (nodes_[node].vertex >= 0) {
+            return nodes_[node].vertex;
+        }
+
+        //  an edge node: its ends are its neighbours on the path
+        int64_t lower_prefix = nodes_[nodes_[node].left].sum + nodes_[node].weight;
+        int64_t upper_prefix = lower_prefix - nodes_[node].weight;
+        int upper = Extreme(nodes_[node].left, true);
+        int lower = Extreme(nodes_[node].right, false);
+        auto eccentricity = [diameter](int64_t prefix) {
+            return std::max(prefix, diameter - prefix);
+        };
+        int center = eccentricity(upper_prefix) <= eccentricity(lower_prefix) ? upper : lower;
+        Splay(center);
+        return center;
+    }
+
+private:
+    struct Far {
+        int64_t distance;
+        int vertex;
+
+        auto operator<=>(const Far&) const = default;
+    };
+
+    static constexpr int64_t kNone = std::numeric_limits<int64_t>::min();
+    static constexpr Far kNoVertex = {kNone, -1};
+
+    struct Node {
+        int left{-1};
+        int right{-1};
+        int parent{-1};  //  splay parent, or path parent at a splay root
+        bool flip{false};
+        int vertex{-1};  //  -1 for an edge node
+        int64_t weight{};
+
+        int64_t sum{};
+        Far head{kNoVertex};  //  farthest cluster vertex from the top of the path
+        Far tail{kNoVertex};  //  the same from the bottom
+        int64_t diameter{kNone};
+        std::multiset<Far> virtual_heads{};
+        std::multiset<int64_t> virtual_diameters{};
+    };
+
+    static uint64_t EncodeEdge(int u_num, int v_num) {
+        if (u_num > v_num) {
+            std::swap(u_num, v_num);
+        }
+        return (static_cast<uint64_t>(static_cast<uint32_t>(u_num)) << 32) |
+            static_cast<uint32_t>(v_num);
+    }
+
+    static Far Shift(Far far, int64_t distance) {
+        return far.vertex < 0 ? far : Far{far.distance + distance, far.vertex};
+    }
+
+    static int64_t Join(Far lhs, Far rhs, int64_t weight) {
+        return lhs.vertex < 0 || rhs.vertex < 0 ? kNone : lhs.distance + rhs.distance + weight;
+    }
+
+    int CreateEdgeNode(int64_t weight) {
+        int edge;
+        if (free_nodes_.empty()) {
+            edge = static_cast<int>(nodes_.size());
+            nodes_.emplace_back();
+        } else {
+            edge = free_nodes_.back();
+            free_nodes_.pop_back();
+        }
+        nodes_[edge].weight = weight;
+        Pull(edge);
+        return edge;
+    }
+
+    void Pull(int node) {
+        auto& current = nodes_[node];
+        //  the two farthest vertices hanging below the node, the node itself included
+        Far first = current.vertex >= 0 ? Far{0, current.vertex} : kNoVertex;
+        Far second = kNoVertex;
+        for (auto iter = current.virtual_heads.rbegin(); iter != current.virtual_heads.rend(); ++iter) {
+            if (*iter > first) {
+                second = first;
+                first = *iter;
+            } else if (*iter > second) {
+                second = *iter;
+            } else {
+                break;
+            }
+        }
+        int64_t diameter = current.vertex >= 0 ? 0 : kNone;
+        if (!current.virtual_diameters.empty()) {
+            diameter = std::max(diameter, *current.virtual_diameters.rbegin());
+        }
+        diameter = std::max(diameter, Join(first, second, current.weight));
+
+        int64_t left_sum = 0;
+        int64_t right_sum = 0;
+        Far left_tail = kNoVertex;
+        Far right_head = kNoVertex;
+        Far head = kNoVertex;
+        Far tail = kNoVertex;
+        if (current.left >= 0) {
+            auto& left = nodes_[current.left];
+            left_sum = left.sum;
+            left_tail = left.tail;
+            head = left.head;
+            diameter = std::max(diameter, left.diameter);
+        }
+        if (current.right >= 0) {
+            auto& right = nodes_[current.right];
+            right_sum = right.sum;
+            right_head = right.head;
+            tail = right.tail;
+            diameter = std::max(diameter, right.diameter);
+        }
+        current.sum = left_sum + current.weight + right_sum;
+        current.head = std::max({head, Shift(first, left_sum + current.weight),
+                                 Shift(right_head, left_sum + current.weight)});
+        current.tail = std::max({tail, Shift(first, right_sum + current.weight),
+                                 Shift(left_tail, right_sum + current.weight)});
+        current.diameter = std::max({diameter, Join(left_tail, first, current.weight),
+                                     Join(left_tail, right_head, current.weight),
+                                     Join(first, right_head, current.weight)});
+    }
+
+    void AddVirtual(int node, int child) {
+        auto& current = nodes_[node];
+        if (nodes_[child].head.vertex >= 0) {
+            current.virtual_heads.insert(nodes_[child].head);
+        }
+        if (nodes_[child].diameter != kNone) {
+            current.virtual_diameters.insert(nodes_[child].diameter);
+        }
+    }
+
+    //  a cluster keeps its farthest vertex and diameter however its splay tree is shaped,
+    //  so the values inserted for a child are still there to erase
+    void RemoveVirtual(int node, int child) {
+        auto& current = nodes_[node];
+        if (nodes_[child].head.vertex >= 0) {
+            current.virtual_heads.erase(current.virtual_heads.find(nodes_[child].head));
+        }
+        if (nodes_[child].diameter != kNone) {
+            current.virtual_diameters.erase(current.virtual_diameters.find(nodes_[child].diameter));
+        }
+    }
+
+    void ApplyFlip(int node) {
+        auto& current = nodes_[node];
+        std::swap(current.left, current.right);
+        std::swap(current.head, current.tail);
+        current.flip = !current.flip;
+    }
+
+    void Push(int node) {
+        auto& current = nodes_[node];
+        if (current.flip) {
+            if (current.left >= 0) {
+                ApplyFlip(current.left);
+            }
+            if (current.right >= 0) {
+                ApplyFlip(current.right);
+            }
+            current.flip = false;
+        }
+    }
+
+    bool IsSplayRoot(int node) const {
+        int parent = nodes_[node].parent;
+        return parent < 0 || (nodes_[parent].left != node && nodes_[parent].right != node);
+    }
+
+    void Rotate(int node) {
+        int parent = nodes_[node].parent;
+        int grand = nodes_[parent].parent;
+        bool parent_is_root = IsSplayRoot(parent);
+        if (nodes_[parent].left == node) {
+            nodes_[parent].left = nodes_[node].right;
+            if (nodes_[node].right >= 0) {
+                nodes_[nodes_[node].right].parent = parent;
+            }
+            nodes_[node].right = parent;
+        } else {
+            nodes_[parent].right = nodes_[node].left;
+            if (nodes_[node].left >= 0) {
+                nodes_[nodes_[node].left].parent = parent;
+            }
+            nodes_[node].left = parent;
+        }
+        nodes_[parent].parent = node;
+        nodes_[node].parent = grand;
+        if (!parent_is_root) {
+            if (nodes_[grand].left == parent) {
+                nodes_[grand].left = node;
+            } else {
+                nodes_[grand].right = node;
+            }
+        }
+        Pull(parent);
+    }
+
+    void Splay(int node) {
+        splay_path_.clear();
+        for (int current = node;; current = nodes_[current].parent) {
+            splay_path_.push_back(current);
+            if (IsSplayRoot(current)) {
+                break;
+            }
+        }
+        for (auto iter = splay_path_.rbegin(); iter != splay_path_.rend(); ++iter) {
+            Push(*iter);
+        }
+        while (!IsSplayRoot(node)) {
+            int parent = nodes_[node].parent;
+            if (!IsSplayRoot(parent)) {
+                int grand = nodes_[parent].parent;
+                bool zig_zig = (nodes_[grand].left == parent) == (nodes_[parent].left == node);
+                Rotate(zig_zig ? parent : node);
+            }
+            Rotate(node);
+        }
+        Pull(node);
+    }
+
+    //  makes the path from the root to the node preferred; the node ends as the splay root
+    //  whose cluster is the whole tree
+    void Access(int node) {
+        for (int current = node, last = -1; current >= 0; last = current, current = nodes_[current].parent) {
+            Splay(current);
+            if (nodes_[current].right >= 0) {
+                AddVirtual(current, nodes_[current].right);
+            }
+            if (last >= 0) {
+                RemoveVirtual(current, last);
+            }
+            nodes_[current].right = last;
+            Pull(current);
+        }
+        Splay(node);
+    }
+
+    void MakeRoot(int node) {
+        Access(node);
+        ApplyFlip(node);
+    }
+
+    int FindRoot(int node) {
+        Access(node);
+        while (true) {
+            Push(node);
+            if (nodes_[node].left < 0) {
+                break;
+            }
+            node = nodes_[node].left;
+        }
+        Splay(node);
+        return node;
+    }
+
+    //  the last (or first) node of a splay subtree in path order
+    int Extreme(int node, bool last) {
+        while (true) {
+            Push(node);
+            int next = last ? nodes_[node].right : nodes_[node].left;
+            if (next < 0) {
+                return node;
+            }
+            node = next;
+        }
+    }
+
+    //  detaches a vertex from the edge node next to it
+    void CutAbove(int v_num, int edge) {
+        MakeRoot(v_num);
+        Access(edge);
+        assert(nodes_[edge].left == v_num && nodes_[v_num].right < 0);
+        nodes_[edge].left = -1;
+        nodes_[v_num].parent = -1;
+        Pull(edge);
+    }
+
+    int size_{};
+    std::vector<Node> nodes_{};
+    std::vector<int> free_nodes_{};
+    std::unordered_map<uint64_t, int> edges_{};
+    std::vector<int> splay_path_{};
+};
+
+#endif //DYNAMIC_FOREST_WEIGHTED_FOREST_H